@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _ASM_UEFI_IO_H
+#define _ASM_UEFI_IO_H
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+#include <asm/byteorder.h>
+
+/*
+ * UEFI identity maps MMIO and framebuffers, so an __iomem pointer is an
+ * ordinary pointer. The accessors are single volatile accesses of their
+ * natural width.
+ */
+static inline u8 __raw_readb(const volatile void __iomem *addr)
+{
+	return *(const volatile u8 __force *)addr;
+}
+
+static inline u16 __raw_readw(const volatile void __iomem *addr)
+{
+	return *(const volatile u16 __force *)addr;
+}
+
+static inline u32 __raw_readl(const volatile void __iomem *addr)
+{
+	return *(const volatile u32 __force *)addr;
+}
+
+static inline u64 __raw_readq(const volatile void __iomem *addr)
+{
+	return *(const volatile u64 __force *)addr;
+}
+
+static inline void __raw_writeb(u8 value, volatile void __iomem *addr)
+{
+	*(volatile u8 __force *)addr = value;
+}
+
+static inline void __raw_writew(u16 value, volatile void __iomem *addr)
+{
+	*(volatile u16 __force *)addr = value;
+}
+
+static inline void __raw_writel(u32 value, volatile void __iomem *addr)
+{
+	*(volatile u32 __force *)addr = value;
+}
+
+static inline void __raw_writeq(u64 value, volatile void __iomem *addr)
+{
+	*(volatile u64 __force *)addr = value;
+}
+
+#define readb(addr)		__raw_readb(addr)
+#define readw(addr)		__le16_to_cpu((__force __le16)__raw_readw(addr))
+#define readl(addr)		__le32_to_cpu((__force __le32)__raw_readl(addr))
+#define readq(addr)		__le64_to_cpu((__force __le64)__raw_readq(addr))
+
+#define writeb(v, addr)		__raw_writeb(v, addr)
+#define writew(v, addr)		__raw_writew((__force u16)__cpu_to_le16(v), addr)
+#define writel(v, addr)		__raw_writel((__force u32)__cpu_to_le32(v), addr)
+#define writeq(v, addr)		__raw_writeq((__force u64)__cpu_to_le64(v), addr)
+
+/*
+ * Implemented in Library/LinuxBaseLib/{X64,AArch64,Arm}/string.c
+ *
+ * The I/O side is only accessed naturally aligned. Where the architecture
+ * has them, stores to it are non-temporal, and the copies are complete
+ * and ordered before anything that follows.
+ */
+extern void memcpy_fromio(void *, const volatile void __iomem *, size_t);
+extern void memcpy_toio(volatile void __iomem *, const void *, size_t);
+extern void memset_io(volatile void __iomem *, int, size_t);
+
+#endif /* _ASM_UEFI_IO_H */
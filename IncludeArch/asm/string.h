@@ -2,6 +2,8 @@
 #ifndef _ASM_UEFI_STRING_H
 #define _ASM_UEFI_STRING_H
 
+/* Implemented in Library/LinuxBaseLib/{X64,AArch64,Arm}/string.c */
+
 #define __HAVE_ARCH_MEMCPY
 extern void * memcpy(void *, const void *, __kernel_size_t);
 
@@ -11,4 +13,60 @@ extern void * memmove(void *, const void *, __kernel_size_t);
 #define __HAVE_ARCH_MEMSET
 extern void * memset(void *, int, __kernel_size_t);
 
+#if defined(MDE_CPU_X64) || defined(MDE_CPU_AARCH64)
+#define __HAVE_ARCH_STRLEN
+extern __kernel_size_t strlen(const char *);
+
+#define __HAVE_ARCH_STRNLEN
+extern __kernel_size_t strnlen(const char *, __kernel_size_t);
+
+#define __HAVE_ARCH_STRCHR
+extern char * strchr(const char *, int);
+
+#define __HAVE_ARCH_STRCHRNUL
+extern char * strchrnul(const char *, int);
+
+#define __HAVE_ARCH_STRNCASECMP
+extern int strncasecmp(const char *, const char *, __kernel_size_t);
+
+#define __HAVE_ARCH_STRCASECMP
+extern int strcasecmp(const char *, const char *);
+
+#define __HAVE_ARCH_STRSPN
+extern __kernel_size_t strspn(const char *, const char *);
+
+#define __HAVE_ARCH_STRCSPN
+extern __kernel_size_t strcspn(const char *, const char *);
+
+#define __HAVE_ARCH_STRPBRK
+extern char * strpbrk(const char *, const char *);
+
+#define __HAVE_ARCH_MEMCHR
+extern void * memchr(const void *, int, __kernel_size_t);
+
+#define __HAVE_ARCH_MEMSCAN
+extern void * memscan(void *, int, __kernel_size_t);
+
+#define __HAVE_ARCH_MEMCMP
+extern int memcmp(const void *, const void *, __kernel_size_t);
+
+#define __HAVE_ARCH_MEMEQ
+extern bool __memeq(const void *, const void *, __kernel_size_t);
+
+#define __HAVE_ARCH_MEMSET16
+extern void *memset16(uint16_t *, uint16_t, __kernel_size_t);
+
+#define __HAVE_ARCH_MEMSET32
+extern void *memset32(uint32_t *, uint32_t, __kernel_size_t);
+
+#define __HAVE_ARCH_MEMSET64
+extern void *memset64(uint64_t *, uint64_t, __kernel_size_t);
+
+#define __HAVE_ARCH_MEMCHR_INV
+extern void *memchr_inv(const void *, int, __kernel_size_t);
+
+#define __HAVE_ARCH_MEMCPY_FLUSHCACHE
+extern void memcpy_flushcache(void *, const void *, __kernel_size_t);
+#endif
+
 #endif /* _ASM_UEFI_STRING_H */
@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_ARENA_H
+#define _LINUX_ARENA_H
+
+#include <linux/types.h>
+#include <linux/gfp.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <stdarg.h>
+
+/*
+ * Arenas hand out memory by bumping a pointer through chunks of pages and
+ * give all of it back at once, with kmem_arena_reset() or
+ * kmem_arena_destroy(). Objects carry no header and cannot be freed one
+ * by one. An arena is not locked, callers sharing one have to serialize.
+ */
+struct kmem_arena_chunk {
+	struct kmem_arena_chunk *next;	/* Next older chunk */
+	size_t size;			/* Including this header */
+};
+
+struct kmem_arena {
+	struct kmem_arena_chunk chunk;	/* The arena lives in its first chunk */
+	struct kmem_arena_chunk *chunks;	/* Newest chunk first */
+	void *cur;			/* Free space of the current chunk */
+	void *end;
+	size_t next_size;		/* Size of the next chunk */
+	gfp_t gfp;
+};
+
+struct kmem_arena *kmem_arena_create(gfp_t gfp);
+void kmem_arena_reset(struct kmem_arena *arena);
+void kmem_arena_destroy(struct kmem_arena *arena);
+void *__kmem_arena_alloc(struct kmem_arena *arena, size_t size,
+			 size_t align) __malloc;
+
+/**
+ * kmem_arena_alloc_aligned - allocate memory from an arena
+ * @arena: the arena to allocate from
+ * @size: how many bytes of memory are required
+ * @align: alignment of the memory, a power of two
+ *
+ * Returns %ZERO_SIZE_PTR for a @size of 0 and %NULL if a new chunk was
+ * needed but could not be allocated.
+ */
+static inline void *kmem_arena_alloc_aligned(struct kmem_arena *arena,
+					     size_t size, size_t align)
+{
+	void *p = PTR_ALIGN(arena->cur, align);
+
+	if (likely(p <= arena->end && size <= arena->end - p && size)) {
+		arena->cur = p + size;
+		return p;
+	}
+
+	return __kmem_arena_alloc(arena, size, align);
+}
+
+/**
+ * kmem_arena_alloc - allocate memory from an arena
+ * @arena: the arena to allocate from
+ * @size: how many bytes of memory are required
+ *
+ * The memory is aligned like kmalloc() memory.
+ */
+static inline void *kmem_arena_alloc(struct kmem_arena *arena, size_t size)
+{
+	return kmem_arena_alloc_aligned(arena, size, ARCH_KMALLOC_MINALIGN);
+}
+
+void *kmem_arena_zalloc(struct kmem_arena *arena, size_t size) __malloc;
+char *kmem_arena_strdup(struct kmem_arena *arena, const char *s) __malloc;
+char *kmem_arena_strndup(struct kmem_arena *arena, const char *s,
+			 size_t max) __malloc;
+void *kmem_arena_memdup(struct kmem_arena *arena, const void *src,
+			size_t len) __malloc;
+__printf(2, 0)
+char *kmem_arena_vasprintf(struct kmem_arena *arena, const char *fmt,
+			   va_list args) __malloc;
+__printf(2, 3)
+char *kmem_arena_asprintf(struct kmem_arena *arena, const char *fmt,
+			  ...) __malloc;
+
+#endif /* _LINUX_ARENA_H */
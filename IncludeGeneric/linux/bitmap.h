@@ -302,7 +302,7 @@ static inline int bitmap_equal(const unsigned long *src1,
 	if (small_const_nbits(nbits))
 		return !((*src1 ^ *src2) & BITMAP_LAST_WORD_MASK(nbits));
 	if (__builtin_constant_p(nbits & 7) && IS_ALIGNED(nbits, 8))
-		return !memcmp(src1, src2, nbits / 8);
+		return memeq(src1, src2, nbits / 8);
 	return __bitmap_equal(src1, src2, nbits);
 }
 
@@ -69,9 +69,22 @@
  * GFP_DMA32 is similar to GFP_DMA except that the caller requires a 32-bit
  *   address.
  */
-#define GFP_ATOMIC	(0)
+#define GFP_ATOMIC	(__GFP_ATOMIC)
 #define GFP_KERNEL	(0)
 #define GFP_DMA		__GFP_DMA
 #define GFP_DMA32	__GFP_DMA32
 
+struct page_frag_cache;
+extern void page_frag_cache_drain(struct page_frag_cache *nc);
+extern void *page_frag_alloc_align(struct page_frag_cache *nc,
+				   unsigned int fragsz, gfp_t gfp_mask,
+				   unsigned int align);
+extern void page_frag_free(void *addr);
+
+static inline void *page_frag_alloc(struct page_frag_cache *nc,
+				    unsigned int fragsz, gfp_t gfp_mask)
+{
+	return page_frag_alloc_align(nc, fragsz, gfp_mask, 1);
+}
+
 #endif /* __LINUX_GFP_H */
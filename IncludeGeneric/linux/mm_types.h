@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_MM_TYPES_H
+#define _LINUX_MM_TYPES_H
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <asm/page.h>
+
+#define PAGE_FRAG_CACHE_MAX_SIZE	__ALIGN_MASK(32768, ~PAGE_MASK)
+
+/*
+ * Fragments are carved from the top of a naturally aligned block of
+ * PAGE_FRAG_CACHE_MAX_SIZE bytes, so page_frag_free() finds the block's
+ * reference count from the fragment address alone.
+ */
+struct page_frag_cache {
+	void *va;
+	unsigned int offset;
+	/* we maintain a pagecount bias, so that we dont dirty cache line
+	 * containing page->_refcount every time we allocate a fragment.
+	 */
+	unsigned int pagecnt_bias;
+};
+
+#endif /* _LINUX_MM_TYPES_H */
@@ -15,6 +15,7 @@
 #include <linux/gfp.h>
 #include <linux/types.h>
 #include <linux/kernel.h>
+#include <asm/page.h>
 
 
 /*
@@ -67,9 +68,129 @@ void kfree(const void *);
 void kzfree(const void *);
 size_t ksize(const void *);
 
+/*
+ * Some archs want to perform DMA into kmalloc caches and need a guaranteed
+ * alignment larger than the alignment of a 64-bit integer.
+ * Setting ARCH_KMALLOC_MINALIGN in arch headers allows that.
+ */
+#ifndef ARCH_KMALLOC_MINALIGN
+#define ARCH_KMALLOC_MINALIGN __alignof__(unsigned long long)
+#endif
+
+/*
+ * Setting ARCH_SLAB_MINALIGN in arch headers allows a different alignment.
+ * Intended for arches that get misalignment faults even for 64 bit integer
+ * aligned buffers.
+ */
+#ifndef ARCH_SLAB_MINALIGN
+#define ARCH_SLAB_MINALIGN __alignof__(unsigned long long)
+#endif
+
+/*
+ * Kmalloc array related definitions
+ *
+ * Requests up to KMALLOC_MAX_CACHE_SIZE are served from the kmalloc-N
+ * slab caches, larger ones get their own run of pages.
+ */
+#define KMALLOC_SHIFT_HIGH	(PAGE_SHIFT + 1)
+#define KMALLOC_SHIFT_LOW	3
+
+/* Maximum size for which we actually use a slab cache */
+#define KMALLOC_MAX_CACHE_SIZE	(1UL << KMALLOC_SHIFT_HIGH)
+
+#ifndef KMALLOC_MIN_SIZE
+#define KMALLOC_MIN_SIZE (1 << KMALLOC_SHIFT_LOW)
+#endif
+
+extern struct kmem_cache *kmalloc_caches[KMALLOC_SHIFT_HIGH + 1];
+
+/*
+ * Figure out which kmalloc slab an allocation of a certain size
+ * belongs to.
+ * 0 = zero alloc
+ * 1 =  65 .. 96 bytes
+ * 2 = 129 .. 192 bytes
+ * n = 2^(n-1)+1 .. 2^n
+ */
+static __always_inline unsigned int kmalloc_index(size_t size)
+{
+	if (!size)
+		return 0;
+
+	if (size <= KMALLOC_MIN_SIZE)
+		return KMALLOC_SHIFT_LOW;
+
+	if (KMALLOC_MIN_SIZE <= 32 && size > 64 && size <= 96)
+		return 1;
+	if (KMALLOC_MIN_SIZE <= 64 && size > 128 && size <= 192)
+		return 2;
+	if (size <=          8) return 3;
+	if (size <=         16) return 4;
+	if (size <=         32) return 5;
+	if (size <=         64) return 6;
+	if (size <=        128) return 7;
+	if (size <=        256) return 8;
+	if (size <=        512) return 9;
+	if (size <=       1024) return 10;
+	if (size <=   2 * 1024) return 11;
+	if (size <=   4 * 1024) return 12;
+	if (size <=   8 * 1024) return 13;
+
+	/* Will never be reached. Needed because the compiler may complain */
+	return -1;
+}
+
 void *__kmalloc(size_t size, gfp_t flags) __malloc;
 void *kmem_cache_alloc(struct kmem_cache *, gfp_t flags) __malloc;
 void kmem_cache_free(struct kmem_cache *, void *);
+void *kmalloc_large(size_t size, gfp_t flags) __malloc;
+
+/*
+ * Build with CONFIG_KMALLOC_PROFILE to have every allocation charged to
+ * its call site; kmalloc_profile_dump() prints the per-site statistics.
+ */
+#ifdef CONFIG_KMALLOC_PROFILE
+void kmalloc_profile_dump(void);
+#else
+static inline void kmalloc_profile_dump(void) { }
+#endif
+
+/*
+ * Build with CONFIG_KMALLOC_TRACE to have every kmalloc(), krealloc(),
+ * kfree() and kmem_cache_*() call recorded in a ring of fixed size
+ * records, meant to be saved and replayed against the allocator outside
+ * of the firmware with Tools/KmallocReplay.
+ */
+enum kmalloc_trace_op {
+	KMALLOC_TRACE_ALLOC,		/* @ptr = kmalloc(@size, @gfp) */
+	KMALLOC_TRACE_FREE,		/* kfree(@ptr) */
+	KMALLOC_TRACE_REALLOC,		/* @ptr = krealloc(@old, @size, @gfp) */
+	KMALLOC_TRACE_CACHE_ALLOC,	/* @ptr = kmem_cache_alloc() */
+	KMALLOC_TRACE_CACHE_FREE,	/* kmem_cache_free(@ptr) */
+};
+
+/*
+ * One 32 byte record per call. @timestamp is in performance counter
+ * ticks, @align_order is log2 of the alignment asked for (the object
+ * alignment of the cache for the CACHE_* events, 0 if none). @size is
+ * the object size for the CACHE_* events. Failed allocations are
+ * recorded with a @ptr of 0. A kmalloc() of constant size goes straight
+ * to its kmalloc cache and is recorded as a CACHE_ALLOC.
+ */
+struct kmalloc_trace_event {
+	u64 timestamp:48;
+	u64 op:8;
+	u64 align_order:8;
+	u64 ptr;
+	u64 old;
+	u32 size;
+	u32 gfp;
+};
+
+#ifdef CONFIG_KMALLOC_TRACE
+u64 kmalloc_trace_count(void);
+size_t kmalloc_trace_snapshot(struct kmalloc_trace_event *buf, size_t nr);
+#endif
 
 /*
  * Bulk allocation and freeing operations. These are accelerated in an
@@ -154,6 +275,18 @@ static __always_inline void *kmem_cache_alloc_node(struct kmem_cache *s, gfp_t f
  */
 static __always_inline void *kmalloc(size_t size, gfp_t flags)
 {
+	if (__builtin_constant_p(size)) {
+		if (size > KMALLOC_MAX_CACHE_SIZE)
+			return kmalloc_large(size, flags);
+		if (!(flags & (GFP_DMA | GFP_DMA32))) {
+			unsigned int index = kmalloc_index(size);
+
+			if (!index)
+				return ZERO_SIZE_PTR;
+
+			return kmem_cache_alloc(kmalloc_caches[index], flags);
+		}
+	}
 	return __kmalloc(size, flags);
 }
 
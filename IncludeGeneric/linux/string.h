@@ -74,6 +74,9 @@ extern char * strstr(const char *, const char *);
 #ifndef __HAVE_ARCH_STRNSTR
 extern char * strnstr(const char *, const char *, size_t);
 #endif
+#ifndef __HAVE_ARCH_MEMMEM
+extern void * memmem(const void *, size_t, const void *, size_t);
+#endif
 #ifndef __HAVE_ARCH_STRLEN
 extern __kernel_size_t strlen(const char *);
 #endif
@@ -138,6 +141,71 @@ extern void * memscan(void *,int,__kernel_size_t);
 #ifndef __HAVE_ARCH_MEMCMP
 extern int memcmp(const void *,const void *,__kernel_size_t);
 #endif
+#ifndef __HAVE_ARCH_MEMEQ
+extern bool __memeq(const void *,const void *,__kernel_size_t);
+#endif
+
+/* One unaligned word of a fixed size memeq() */
+struct __memeq_una {
+	unsigned long x;
+} __packed __attribute__((__may_alias__));
+
+static __always_inline unsigned long __memeq_word(const void *p)
+{
+	return ((const struct __memeq_una *)p)->x;
+}
+
+static __always_inline bool __memeq_fixed(const void *a, const void *b,
+					  __kernel_size_t n)
+{
+	unsigned long diff = 0;
+	__kernel_size_t i;
+
+	for (i = 0; i < n; i += sizeof(unsigned long))
+		diff |= __memeq_word(a + i) ^ __memeq_word(b + i);
+	return !diff;
+}
+
+static __always_inline bool memeq16(const void *a, const void *b)
+{
+	return __memeq_fixed(a, b, 16);
+}
+
+static __always_inline bool memeq32(const void *a, const void *b)
+{
+	return __memeq_fixed(a, b, 32);
+}
+
+static __always_inline bool memeq64(const void *a, const void *b)
+{
+	return __memeq_fixed(a, b, 64);
+}
+
+/**
+ * memeq - Check two areas of memory for equality
+ * @a: One area of memory
+ * @b: Another area of memory
+ * @n: The size of the areas
+ *
+ * Like !memcmp(), but stops at the first difference without working out
+ * which area sorts first. Constant sizes of 16, 32 and 64 bytes are
+ * compared inline, without branches.
+ */
+static __always_inline bool memeq(const void *a, const void *b,
+				  __kernel_size_t n)
+{
+	if (__builtin_constant_p(n)) {
+		switch (n) {
+		case 16:
+			return memeq16(a, b);
+		case 32:
+			return memeq32(a, b);
+		case 64:
+			return memeq64(a, b);
+		}
+	}
+	return __memeq(a, b, n);
+}
 #ifndef __HAVE_ARCH_MEMCHR
 extern void * memchr(const void *,int,__kernel_size_t);
 #endif
@@ -166,6 +234,16 @@ extern char *kstrndup(const char *s, size_t len, gfp_t gfp);
 extern void *kmemdup(const void *src, size_t len, gfp_t gfp);
 extern char *kmemdup_nul(const char *s, size_t len, gfp_t gfp);
 
+extern const char *kstrintern(const char *s);
+extern const char *kstrintern_len(const char *s, size_t len);
+extern const char *kstrintern_find(const char *s);
+
+/* Interned strings are equal if and only if they are the same pointer */
+static inline bool kstrintern_eq(const char *a, const char *b)
+{
+	return a == b;
+}
+
 extern char **argv_split(gfp_t gfp, const char *str, int *argcp);
 extern void argv_free(char **argv);
 
@@ -188,6 +266,29 @@ int __sysfs_match_string(const char * const *array, size_t n, const char *s);
  */
 #define sysfs_match_string(_a, _s) __sysfs_match_string(_a, ARRAY_SIZE(_a), _s)
 
+/*
+ * A minimal perfect hash over a constant table of strings, for tables
+ * that are looked up often enough to make match_string() too slow.
+ */
+struct string_matcher_slot {
+	u32 index;			/* Into the table */
+	u32 tag;			/* Low half of the entry's hash */
+};
+
+struct string_matcher {
+	const char * const *array;
+	u32 *disp;			/* Displacement of each bucket */
+	struct string_matcher_slot *slots;
+	u32 nr_buckets;
+	u32 nr_slots;
+	bool sysfs;			/* Compare with sysfs_streq() */
+};
+
+int string_matcher_init(struct string_matcher *sm, const char * const *array,
+			size_t n, bool sysfs, gfp_t gfp);
+void string_matcher_free(struct string_matcher *sm);
+int string_matcher_match(const struct string_matcher *sm, const char *str);
+
 #ifdef CONFIG_BINARY_PRINTF
 int vbin_printf(u32 *bin_buf, size_t size, const char *fmt, va_list args);
 int bstr_printf(char *buf, size_t size, const char *fmt, const u32 *bin_buf);
@@ -424,6 +525,33 @@ __FORTIFY_INLINE char *strcpy(char *p, const char *q)
 	return p;
 }
 
+#else
+
+/*
+ * The library is built with -fno-builtin, which keeps GCC from turning
+ * the loops in string.c into calls of themselves but also from expanding
+ * a memcpy() of a GUID or a strlen() of a literal in place. Hand those
+ * to the builtins: constant sizes up to __STRING_INLINE_MAX bytes and
+ * constant strings are done inline, anything else still calls the
+ * library. Files that define these functions #undef them first.
+ */
+#define __STRING_INLINE_MAX	64
+
+#define __string_inline_size(n)						\
+	(__builtin_constant_p(n) && (n) <= __STRING_INLINE_MAX)
+
+#define memcpy(p, q, n)							\
+	(__string_inline_size(n) ? __builtin_memcpy(p, q, n) :		\
+	 (memcpy)(p, q, n))
+#define memset(p, c, n)							\
+	(__string_inline_size(n) ? __builtin_memset(p, c, n) :		\
+	 (memset)(p, c, n))
+#define memcmp(p, q, n)							\
+	(__string_inline_size(n) ? __builtin_memcmp(p, q, n) :		\
+	 (memcmp)(p, q, n))
+#define strlen(p)							\
+	(__builtin_constant_p(p) ? __builtin_strlen(p) : (strlen)(p))
+
 #endif
 
 /**
@@ -43,7 +43,7 @@ extern const uuid_t uuid_null;
 
 static inline bool guid_equal(const guid_t *u1, const guid_t *u2)
 {
-	return memcmp(u1, u2, sizeof(guid_t)) == 0;
+	return memeq(u1, u2, sizeof(guid_t));
 }
 
 static inline void guid_copy(guid_t *dst, const guid_t *src)
@@ -58,7 +58,7 @@ static inline bool guid_is_null(const guid_t *guid)
 
 static inline bool uuid_equal(const uuid_t *u1, const uuid_t *u2)
 {
-	return memcmp(u1, u2, sizeof(uuid_t)) == 0;
+	return memeq(u1, u2, sizeof(uuid_t));
 }
 
 static inline void uuid_copy(uuid_t *dst, const uuid_t *src)
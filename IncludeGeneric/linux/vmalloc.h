@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_VMALLOC_H
+#define _LINUX_VMALLOC_H
+
+#include <linux/types.h>
+#include <linux/gfp.h>
+
+/*
+ *	Highlevel APIs for driver use
+ *
+ * Firmware memory is identity mapped, so there is nothing to map: a
+ * vmalloc area is a run of whole pages, the same kind kmalloc() hands
+ * out for big requests, and it is page aligned.
+ */
+extern void *vmalloc(unsigned long size);
+extern void *vzalloc(unsigned long size);
+extern void *vmalloc_node(unsigned long size, int node);
+extern void *vzalloc_node(unsigned long size, int node);
+extern void *vmalloc_32(unsigned long size);
+extern void *__vmalloc(unsigned long size, gfp_t gfp_mask);
+
+extern void vfree(const void *addr);
+
+#endif /* _LINUX_VMALLOC_H */
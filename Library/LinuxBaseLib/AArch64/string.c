@@ -0,0 +1,802 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Memory and string functions for AArch64
+ *
+ * Up to 32 bytes are handled here with overlapping general purpose
+ * register accesses. Longer blocks go to the AdvSIMD loops in
+ * string_neon.S when the CPU has AdvSIMD, which is decided on first use
+ * from ID_AA64PFR0_EL1, and to the LDP/STP loops below otherwise. Copies
+ * and fills of at least STRING_NT_THRESHOLD bytes use STNP, so that
+ * moving a kernel image or a framebuffer does not evict everything else
+ * from the caches.
+ *
+ * The string and memory scans use AdvSIMD as well.
+ *
+ * The library is built with -mgeneral-regs-only, which is why the vector
+ * code lives in an assembler file.
+ */
+
+#include <LinuxBase.h>
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/export.h>
+#include <linux/compiler.h>
+#include <linux/kernel.h>
+#include <linux/bitops.h>
+#include <linux/ctype.h>
+#include <linux/io.h>
+
+#include <asm/page.h>
+
+#define STRING_NT_THRESHOLD	(1024 * 1024)
+
+#define ARM64_STRING_PROBED	BIT(0)
+#define ARM64_STRING_SIMD	BIT(1)
+
+#define ID_AA64PFR0_ADVSIMD_SHIFT	20
+#define ID_AA64PFR0_ADVSIMD_NI		0xf
+
+typedef u64 u64u __attribute__((aligned(1), may_alias));
+typedef u32 u32u __attribute__((aligned(1), may_alias));
+typedef u16 u16u __attribute__((aligned(1), may_alias));
+
+void __memcpy_neon(void *dest, const void *src, size_t count);
+void __memcpy_neon_nt(void *dest, const void *src, size_t count);
+void __memmove_neon_backward(void *dest, const void *src, size_t count);
+void __memset_neon(void *s, u64 pattern, size_t count);
+void __memset_neon_nt(void *s, u64 pattern, size_t count);
+const char *__strchrnul_neon(const char *s, int c);
+const void *__memchr_neon(const void *s, int c, size_t count);
+size_t __memdiff_neon(const void *a, const void *b, size_t count);
+size_t __strspn_neon(const char *s, const u8 *set, bool reject);
+size_t __strcasediff_neon(const char *s1, const char *s2, size_t count);
+void *__memchr_inv_neon(const void *s, int c, size_t count);
+
+static unsigned int arm64_string_caps;
+
+static noinline unsigned int arm64_string_probe(void)
+{
+	unsigned int caps = ARM64_STRING_PROBED;
+	u64 pfr0;
+
+	asm("mrs %0, id_aa64pfr0_el1" : "=r" (pfr0));
+	if (((pfr0 >> ID_AA64PFR0_ADVSIMD_SHIFT) & 0xf) !=
+	    ID_AA64PFR0_ADVSIMD_NI)
+		caps |= ARM64_STRING_SIMD;
+
+	/* Racing probes store the same value */
+	WRITE_ONCE(arm64_string_caps, caps);
+	return caps;
+}
+
+static __always_inline bool arm64_string_simd(void)
+{
+	unsigned int caps = READ_ONCE(arm64_string_caps);
+
+	if (unlikely(!caps))
+		caps = arm64_string_probe();
+	return caps & ARM64_STRING_SIMD;
+}
+
+/* Up to 32 bytes, everything is loaded before anything is stored */
+static __always_inline void copy_small(void *dest, const void *src, size_t n)
+{
+	if (n >= 16) {
+		u64 a = ((u64u *)src)[0];
+		u64 b = ((u64u *)src)[1];
+		u64 c = ((u64u *)(src + n - 16))[0];
+		u64 d = ((u64u *)(src + n - 16))[1];
+
+		((u64u *)dest)[0] = a;
+		((u64u *)dest)[1] = b;
+		((u64u *)(dest + n - 16))[0] = c;
+		((u64u *)(dest + n - 16))[1] = d;
+	} else if (n >= 8) {
+		u64 a = *(u64u *)src;
+		u64 b = *(u64u *)(src + n - 8);
+
+		*(u64u *)dest = a;
+		*(u64u *)(dest + n - 8) = b;
+	} else if (n >= 4) {
+		u32 a = *(u32u *)src;
+		u32 b = *(u32u *)(src + n - 4);
+
+		*(u32u *)dest = a;
+		*(u32u *)(dest + n - 4) = b;
+	} else if (n) {
+		u8 a = *(u8 *)src;
+		u8 b = *(u8 *)(src + n / 2);
+		u8 c = *(u8 *)(src + n - 1);
+
+		*(u8 *)dest = a;
+		*(u8 *)(dest + n / 2) = b;
+		*(u8 *)(dest + n - 1) = c;
+	}
+}
+
+/*
+ * The general purpose register versions of the loops in string_neon.S,
+ * with the same head and tail handling.
+ */
+static noinline void copy_forward(void *dest, const void *src, size_t n)
+{
+	u64 h0 = ((u64u *)src)[0], h1 = ((u64u *)src)[1];
+	u64 t0 = ((u64u *)(src + n - 16))[0], t1 = ((u64u *)(src + n - 16))[1];
+	void *d = PTR_ALIGN(dest + 1, 16);
+	const void *s = src + (d - dest);
+	void *end = dest + n - 16;
+
+	for (; d + 32 <= end; d += 32, s += 32) {
+		u64 a = ((u64u *)s)[0], b = ((u64u *)s)[1];
+		u64 c = ((u64u *)s)[2], e = ((u64u *)s)[3];
+
+		((u64 *)d)[0] = a;
+		((u64 *)d)[1] = b;
+		((u64 *)d)[2] = c;
+		((u64 *)d)[3] = e;
+	}
+	for (; d < end; d += 16, s += 16) {
+		u64 a = ((u64u *)s)[0], b = ((u64u *)s)[1];
+
+		((u64 *)d)[0] = a;
+		((u64 *)d)[1] = b;
+	}
+
+	((u64u *)end)[0] = t0;
+	((u64u *)end)[1] = t1;
+	((u64u *)dest)[0] = h0;
+	((u64u *)dest)[1] = h1;
+}
+
+static noinline void copy_backward(void *dest, const void *src, size_t n)
+{
+	u64 h0 = ((u64u *)src)[0], h1 = ((u64u *)src)[1];
+	u64 t0 = ((u64u *)(src + n - 16))[0], t1 = ((u64u *)(src + n - 16))[1];
+	void *d = (void *)ALIGN_DOWN((unsigned long)dest + n - 1, 16);
+	const void *s = src + (d - dest);
+
+	while (d - dest > 16) {
+		u64 a, b;
+
+		d -= 16;
+		s -= 16;
+		a = ((u64u *)s)[0];
+		b = ((u64u *)s)[1];
+		((u64 *)d)[0] = a;
+		((u64 *)d)[1] = b;
+	}
+
+	((u64u *)dest)[0] = h0;
+	((u64u *)dest)[1] = h1;
+	((u64u *)(dest + n - 16))[0] = t0;
+	((u64u *)(dest + n - 16))[1] = t1;
+}
+
+static noinline void fill_forward(void *s, u64 v, size_t n)
+{
+	void *d = PTR_ALIGN(s + 1, 16);
+	void *end = s + n - 16;
+
+	((u64u *)s)[0] = v;
+	((u64u *)s)[1] = v;
+	for (; d + 32 <= end; d += 32) {
+		((u64 *)d)[0] = v;
+		((u64 *)d)[1] = v;
+		((u64 *)d)[2] = v;
+		((u64 *)d)[3] = v;
+	}
+	for (; d < end; d += 16) {
+		((u64 *)d)[0] = v;
+		((u64 *)d)[1] = v;
+	}
+	((u64u *)end)[0] = v;
+	((u64u *)end)[1] = v;
+}
+
+static void copy_large(void *dest, const void *src, size_t n)
+{
+	if (!arm64_string_simd())
+		copy_forward(dest, src, n);
+	else if (n >= STRING_NT_THRESHOLD)
+		__memcpy_neon_nt(dest, src, n);
+	else
+		__memcpy_neon(dest, src, n);
+}
+
+/**
+ * memcpy - Copy one area of memory to another
+ * @dest: Where to copy to
+ * @src: Where to copy from
+ * @count: The size of the area.
+ */
+#undef memcpy
+void *memcpy(void *dest, const void *src, size_t count)
+{
+	if (count <= 32)
+		copy_small(dest, src, count);
+	else
+		copy_large(dest, src, count);
+	return dest;
+}
+EXPORT_SYMBOL(memcpy);
+
+/**
+ * memmove - Copy one area of memory to another
+ * @dest: Where to copy to
+ * @src: Where to copy from
+ * @count: The size of the area.
+ *
+ * Unlike memcpy(), memmove() copes with overlapping areas.
+ */
+void *memmove(void *dest, const void *src, size_t count)
+{
+	if (count <= 32)
+		copy_small(dest, src, count);
+	else if (src + count <= dest || dest + count <= src)
+		copy_large(dest, src, count);
+	else if (dest < src && arm64_string_simd())
+		__memcpy_neon(dest, src, count);
+	else if (dest < src)
+		copy_forward(dest, src, count);
+	else if (dest > src && arm64_string_simd())
+		__memmove_neon_backward(dest, src, count);
+	else if (dest > src)
+		copy_backward(dest, src, count);
+	return dest;
+}
+EXPORT_SYMBOL(memmove);
+
+/*
+ * Fill at least two bytes with a repeating @pattern. memset16() and
+ * friends pass a multiple of the element size and @s aligned to it, so
+ * the overlapping and aligned stores all stay in phase.
+ */
+static __always_inline void fill_pattern(void *s, u64 pattern, size_t n)
+{
+	if (n > 32) {
+		if (!arm64_string_simd())
+			fill_forward(s, pattern, n);
+		else if (n >= STRING_NT_THRESHOLD)
+			__memset_neon_nt(s, pattern, n);
+		else
+			__memset_neon(s, pattern, n);
+	} else if (n >= 16) {
+		((u64u *)s)[0] = pattern;
+		((u64u *)s)[1] = pattern;
+		((u64u *)(s + n - 16))[0] = pattern;
+		((u64u *)(s + n - 16))[1] = pattern;
+	} else if (n >= 8) {
+		*(u64u *)s = pattern;
+		*(u64u *)(s + n - 8) = pattern;
+	} else if (n >= 4) {
+		*(u32u *)s = pattern;
+		*(u32u *)(s + n - 4) = pattern;
+	} else {
+		*(u16u *)s = pattern;
+	}
+}
+
+/**
+ * memset - Fill a region of memory with the given value
+ * @s: Pointer to the start of the area.
+ * @c: The byte to fill the area with
+ * @count: The size of the area.
+ */
+#undef memset
+void *memset(void *s, int c, size_t count)
+{
+	if (count >= 4) {
+		fill_pattern(s, (u8)c * 0x0101010101010101ULL, count);
+	} else if (count) {
+		*(u8 *)s = c;
+		*(u8 *)(s + count / 2) = c;
+		*(u8 *)(s + count - 1) = c;
+	}
+	return s;
+}
+EXPORT_SYMBOL(memset);
+
+/**
+ * memset16() - Fill a memory area with a uint16_t
+ * @s: Pointer to the start of the area.
+ * @v: The value to fill the area with
+ * @count: The number of values to store
+ */
+void *memset16(uint16_t *s, uint16_t v, size_t count)
+{
+	if (count)
+		fill_pattern(s, v * 0x0001000100010001ULL, count * 2);
+	return s;
+}
+EXPORT_SYMBOL(memset16);
+
+/**
+ * memset32() - Fill a memory area with a uint32_t
+ * @s: Pointer to the start of the area.
+ * @v: The value to fill the area with
+ * @count: The number of values to store
+ */
+void *memset32(uint32_t *s, uint32_t v, size_t count)
+{
+	if (count)
+		fill_pattern(s, v * 0x0000000100000001ULL, count * 4);
+	return s;
+}
+EXPORT_SYMBOL(memset32);
+
+/**
+ * memset64() - Fill a memory area with a uint64_t
+ * @s: Pointer to the start of the area.
+ * @v: The value to fill the area with
+ * @count: The number of values to store
+ */
+void *memset64(uint64_t *s, uint64_t v, size_t count)
+{
+	if (count)
+		fill_pattern(s, v, count * 8);
+	return s;
+}
+EXPORT_SYMBOL(memset64);
+
+/* Cores without AdvSIMD do not run UEFI in practice, keep it simple */
+static const char *strchrnul_bytes(const char *s, int c)
+{
+	while (*s && *s != (char)c)
+		s++;
+	return s;
+}
+
+static const void *memchr_bytes(const void *s, int c, size_t n)
+{
+	const unsigned char *p = s;
+
+	for (; n; n--, p++)
+		if (*p == (unsigned char)c)
+			return p;
+	return NULL;
+}
+
+static __always_inline const char *__strchrnul(const char *s, int c)
+{
+	if (arm64_string_simd())
+		return __strchrnul_neon(s, c);
+	return strchrnul_bytes(s, c);
+}
+
+static __always_inline const void *__memchr(const void *s, int c, size_t n)
+{
+	if (arm64_string_simd())
+		return __memchr_neon(s, c, n);
+	return memchr_bytes(s, c, n);
+}
+
+/**
+ * strlen - Find the length of a string
+ * @s: The string to be sized
+ */
+#undef strlen
+size_t strlen(const char *s)
+{
+	return __strchrnul(s, 0) - s;
+}
+EXPORT_SYMBOL(strlen);
+
+/**
+ * strnlen - Find the length of a length-limited string
+ * @s: The string to be sized
+ * @count: The maximum number of bytes to search
+ */
+size_t strnlen(const char *s, size_t count)
+{
+	const char *sc = __memchr(s, 0, count);
+
+	return sc ? sc - s : count;
+}
+EXPORT_SYMBOL(strnlen);
+
+/**
+ * strchr - Find the first occurrence of a character in a string
+ * @s: The string to be searched
+ * @c: The character to search for
+ */
+char *strchr(const char *s, int c)
+{
+	s = __strchrnul(s, c);
+	return *s == (char)c ? (char *)s : NULL;
+}
+EXPORT_SYMBOL(strchr);
+
+/**
+ * strchrnul - Find and return a character in a string, or end of string
+ * @s: The string to be searched
+ * @c: The character to search for
+ *
+ * Returns pointer to first occurrence of 'c' in s. If c is not found, then
+ * return a pointer to the null byte at the end of s.
+ */
+char *strchrnul(const char *s, int c)
+{
+	return (char *)__strchrnul(s, c);
+}
+EXPORT_SYMBOL(strchrnul);
+
+/**
+ * memchr - Find a character in an area of memory.
+ * @s: The memory area
+ * @c: The byte to search for
+ * @n: The size of the area.
+ *
+ * returns the address of the first occurrence of @c, or %NULL
+ * if @c is not found
+ */
+void *memchr(const void *s, int c, size_t n)
+{
+	return (void *)__memchr(s, c, n);
+}
+EXPORT_SYMBOL(memchr);
+
+/**
+ * memscan - Find a character in an area of memory.
+ * @addr: The memory area
+ * @c: The byte to search for
+ * @size: The size of the area.
+ *
+ * returns the address of the first occurrence of @c, or 1 byte past
+ * the area if @c is not found
+ */
+void *memscan(void *addr, int c, size_t size)
+{
+	const void *p = __memchr(addr, c, size);
+
+	return p ? (void *)p : addr + size;
+}
+EXPORT_SYMBOL(memscan);
+
+/*
+ * Length of the initial run of @s made of bytes in @chars, or with
+ * @reject of bytes not in it. NUL is added to the set for @reject, so
+ * either way the scan stops at the end of @s. The set is a pair of
+ * nibble tables for __strspn_neon(), see there, or a 256 bit map.
+ */
+static size_t __strspn(const char *s, const char *chars, bool reject)
+{
+	const unsigned char *p = (const unsigned char *)chars;
+	unsigned long map[256 / BITS_PER_LONG] = { 0 };
+	u8 set[32] __aligned(16) = { 0 };
+
+	if (!p[0])
+		return reject ? __strchrnul(s, 0) - s : 0;
+	if (reject && !p[1])
+		return __strchrnul(s, p[0]) - s;
+
+	if (arm64_string_simd()) {
+		for (; *p; p++)
+			set[(*p & 0x80) >> 3 | (*p & 15)] |= 1 << (*p >> 4 & 7);
+		if (reject)
+			set[0] |= 1;
+		return __strspn_neon(s, set, reject);
+	}
+
+	for (; *p; p++)
+		map[BIT_WORD(*p)] |= BIT_MASK(*p);
+	if (reject)
+		map[0] |= 1;
+
+	for (p = (const unsigned char *)s;
+	     !!(map[BIT_WORD(*p)] & BIT_MASK(*p)) != reject; p++)
+		;
+	return p - (const unsigned char *)s;
+}
+
+/**
+ * strspn - Calculate the length of the initial substring of @s which only contain letters in @accept
+ * @s: The string to be searched
+ * @accept: The string to search for
+ */
+size_t strspn(const char *s, const char *accept)
+{
+	return __strspn(s, accept, false);
+}
+EXPORT_SYMBOL(strspn);
+
+/**
+ * strcspn - Calculate the length of the initial substring of @s which does not contain letters in @reject
+ * @s: The string to be searched
+ * @reject: The string to avoid
+ */
+size_t strcspn(const char *s, const char *reject)
+{
+	return __strspn(s, reject, true);
+}
+EXPORT_SYMBOL(strcspn);
+
+/**
+ * strpbrk - Find the first occurrence of a set of characters
+ * @cs: The string to be searched
+ * @ct: The characters to search for
+ */
+char *strpbrk(const char *cs, const char *ct)
+{
+	cs += __strspn(cs, ct, true);
+	return *cs ? (char *)cs : NULL;
+}
+EXPORT_SYMBOL(strpbrk);
+
+/*
+ * Case insensitive compare of at most @len bytes. __strcasediff_neon() skips blocks
+ * of 16 bytes that match after folding ASCII case and hold no NUL, as
+ * long as neither string can run into the next page. The block it stops
+ * at goes through tolower(), which knows Latin-1 as well.
+ */
+static int __strncasecmp(const char *s1, const char *s2, size_t len)
+{
+	/* Yes, Virginia, it had better be unsigned */
+	unsigned char c1, c2;
+	size_t n;
+
+	while (len) {
+		n = min3(len, PAGE_SIZE - ((unsigned long)s1 & ~PAGE_MASK),
+			 PAGE_SIZE - ((unsigned long)s2 & ~PAGE_MASK)) & ~15UL;
+		if (n && arm64_string_simd()) {
+			n = __strcasediff_neon(s1, s2, n);
+			s1 += n;
+			s2 += n;
+			len -= n;
+		}
+
+		for (n = min_t(size_t, len, 16), len -= n; n; n--) {
+			c1 = *s1++;
+			c2 = *s2++;
+			if (!c1 || !c2)
+				return (int)c1 - (int)c2;
+			if (c1 == c2)
+				continue;
+			c1 = tolower(c1);
+			c2 = tolower(c2);
+			if (c1 != c2)
+				return (int)c1 - (int)c2;
+		}
+	}
+	return 0;
+}
+
+/**
+ * strncasecmp - Case insensitive, length-limited string comparison
+ * @s1: One string
+ * @s2: The other string
+ * @len: the maximum number of characters to compare
+ */
+int strncasecmp(const char *s1, const char *s2, size_t len)
+{
+	return __strncasecmp(s1, s2, len);
+}
+EXPORT_SYMBOL(strncasecmp);
+
+int strcasecmp(const char *s1, const char *s2)
+{
+	return __strncasecmp(s1, s2, SIZE_MAX);
+}
+EXPORT_SYMBOL(strcasecmp);
+
+/* Index of the first byte that differs between two areas, or @n */
+static size_t memdiff(const void *a, const void *b, size_t n)
+{
+	u64 x;
+	size_t i;
+
+	if (n >= 16 && arm64_string_simd())
+		return __memdiff_neon(a, b, n);
+
+	for (i = 0; n - i >= 8; i += 8) {
+		x = *(u64u *)(a + i) ^ *(u64u *)(b + i);
+		if (x)
+			return i + __builtin_ctzll(x) / 8;
+	}
+	for (; i < n; i++)
+		if (((u8 *)a)[i] != ((u8 *)b)[i])
+			break;
+	return i;
+}
+
+/**
+ * memcmp - Compare two areas of memory
+ * @cs: One area of memory
+ * @ct: Another area of memory
+ * @count: The size of the area.
+ */
+#undef memcmp
+int memcmp(const void *cs, const void *ct, size_t count)
+{
+	size_t i = memdiff(cs, ct, count);
+
+	return i < count ? ((u8 *)cs)[i] - ((u8 *)ct)[i] : 0;
+}
+EXPORT_SYMBOL(memcmp);
+
+/* Out of line part of memeq() */
+bool __memeq(const void *cs, const void *ct, size_t count)
+{
+	return memdiff(cs, ct, count) == count;
+}
+EXPORT_SYMBOL(__memeq);
+
+/**
+ * memchr_inv - Find an unmatching character in an area of memory.
+ * @start: The memory area
+ * @c: Find a character other than c
+ * @bytes: The size of the area.
+ *
+ * returns the address of the first character other than @c, or %NULL
+ * if the whole buffer contains just @c.
+ */
+void *memchr_inv(const void *start, int c, size_t bytes)
+{
+	u64 pattern = (u8)c * 0x0101010101010101ULL;
+	const void *p = start;
+	u64 x;
+
+	if (bytes >= 16 && arm64_string_simd())
+		return __memchr_inv_neon(start, c, bytes);
+
+	for (; bytes >= 8; bytes -= 8, p += 8) {
+		x = *(u64u *)p ^ pattern;
+		if (x)
+			return (void *)p + __builtin_ctzll(x) / 8;
+	}
+	for (; bytes; bytes--, p++)
+		if (*(u8 *)p != (u8)c)
+			return (void *)p;
+	return NULL;
+}
+EXPORT_SYMBOL(memchr_inv);
+
+/*
+ * Copies to and from I/O memory, and memcpy_flushcache(). The I/O side
+ * is accessed naturally aligned, which Device memory requires, read up
+ * to 8 bytes and written up to 16 bytes at a time. The 16 byte blocks go
+ * out through STNP, which keeps them out of the caches where the memory
+ * is cacheable at all.
+ */
+static __always_inline void stnp_x(void *d, u64 a, u64 b)
+{
+	asm volatile("stnp %1, %2, [%0]" : : "r" (d), "r" (a), "r" (b)
+		     : "memory");
+}
+
+static __always_inline void store_io(void *d, const void *s, size_t size)
+{
+	switch (size) {
+	case 1:
+		*(volatile u8 *)d = *(const u8 *)s;
+		break;
+	case 2:
+		*(volatile u16 *)d = *(const u16u *)s;
+		break;
+	case 4:
+		*(volatile u32 *)d = *(const u32u *)s;
+		break;
+	case 8:
+		*(volatile u64 *)d = *(const u64u *)s;
+		break;
+	case 16:
+		stnp_x(d, ((const u64u *)s)[0], ((const u64u *)s)[1]);
+		break;
+	}
+}
+
+/* With @fill, @s is a 16 byte pattern that is stored over and over */
+static __always_inline void write_io(void *d, const void *s, size_t n,
+				     bool fill)
+{
+	size_t size;
+
+	for (size = 1; size < 16; size *= 2) {
+		if (n >= size && ((unsigned long)d & size)) {
+			store_io(d, s, size);
+			d += size;
+			s += fill ? 0 : size;
+			n -= size;
+		}
+	}
+	for (size = 16; size; size /= 2) {
+		for (; n >= size; n -= size, d += size, s += fill ? 0 : size)
+			store_io(d, s, size);
+	}
+}
+
+static __always_inline void load_io(void *d, const void *s, size_t size)
+{
+	switch (size) {
+	case 1:
+		*(u8 *)d = *(const volatile u8 *)s;
+		break;
+	case 2:
+		*(u16u *)d = *(const volatile u16 *)s;
+		break;
+	case 4:
+		*(u32u *)d = *(const volatile u32 *)s;
+		break;
+	case 8:
+		*(u64u *)d = *(const volatile u64 *)s;
+		break;
+	}
+}
+
+/**
+ * memcpy_fromio - Copy from I/O memory
+ * @dest: Where to copy to
+ * @src: Where to copy from, in I/O memory
+ * @count: The size of the area.
+ */
+void memcpy_fromio(void *dest, const volatile void __iomem *src, size_t count)
+{
+	const void *s = (const void __force *)src;
+	size_t size;
+
+	for (size = 1; size < 8; size *= 2) {
+		if (count >= size && ((unsigned long)s & size)) {
+			load_io(dest, s, size);
+			dest += size;
+			s += size;
+			count -= size;
+		}
+	}
+	for (size = 8; size; size /= 2) {
+		for (; count >= size; count -= size, dest += size, s += size)
+			load_io(dest, s, size);
+	}
+}
+EXPORT_SYMBOL(memcpy_fromio);
+
+/**
+ * memcpy_toio - Copy to I/O memory
+ * @dest: Where to copy to, in I/O memory
+ * @src: Where to copy from
+ * @count: The size of the area.
+ */
+void memcpy_toio(volatile void __iomem *dest, const void *src, size_t count)
+{
+	write_io((void __force *)dest, src, count, false);
+	asm volatile("dmb oshst" : : : "memory");
+}
+EXPORT_SYMBOL(memcpy_toio);
+
+/**
+ * memset_io - Fill I/O memory with the given value
+ * @s: Pointer to the start of the area, in I/O memory
+ * @c: The byte to fill the area with
+ * @count: The size of the area.
+ */
+void memset_io(volatile void __iomem *s, int c, size_t count)
+{
+	u64 pattern[2];
+
+	pattern[0] = pattern[1] = (u8)c * 0x0101010101010101ULL;
+	write_io((void __force *)s, pattern, count, true);
+	asm volatile("dmb oshst" : : : "memory");
+}
+EXPORT_SYMBOL(memset_io);
+
+/**
+ * memcpy_flushcache - Copy to memory, bypassing the caches
+ * @dst: Where to copy to
+ * @src: Where to copy from
+ * @cnt: The size of the area.
+ *
+ * The data is in memory rather than in a cache on return. STNP is only a
+ * hint, so the lines written are cleaned to the point of coherency.
+ */
+void memcpy_flushcache(void *dst, const void *src, size_t cnt)
+{
+	unsigned long line, addr, end = (unsigned long)dst + cnt;
+	u64 ctr;
+
+	write_io(dst, src, cnt, false);
+
+	asm("mrs %0, ctr_el0" : "=r" (ctr));
+	line = 4UL << ((ctr >> 16) & 0xf);
+	for (addr = (unsigned long)dst & ~(line - 1); addr < end; addr += line)
+		asm volatile("dc cvac, %0" : : "r" (addr) : "memory");
+	asm volatile("dsb sy" : : : "memory");
+}
+EXPORT_SYMBOL(memcpy_flushcache);
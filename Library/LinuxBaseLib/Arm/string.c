@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * memcpy, memmove, memset and the I/O copies for ARM
+ *
+ * Word at a time C, moving 32 bytes per iteration where source and
+ * destination allow it, which the compiler turns into LDM/STM pairs.
+ * A source that is misaligned relative to the destination is read in
+ * aligned words and shifted into place.
+ *
+ * The VFP/NEON registers are left alone: the firmware's exception entry
+ * does not save them. There is no non-temporal store in AArch32 either,
+ * so unlike on the 64 bit architectures there is nothing to pick at run
+ * time.
+ */
+
+#include <LinuxBase.h>
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/export.h>
+#include <linux/compiler.h>
+#include <linux/kernel.h>
+#include <linux/io.h>
+
+#include <asm/unaligned.h>
+
+typedef u32 u32a __attribute__((may_alias));
+
+static __always_inline void copy_words_forward(u8 *d, const u8 *s, size_t n)
+{
+	for (; n >= 32; n -= 32, d += 32, s += 32) {
+		u32 a = ((u32a *)s)[0], b = ((u32a *)s)[1];
+		u32 c = ((u32a *)s)[2], e = ((u32a *)s)[3];
+		u32 f = ((u32a *)s)[4], g = ((u32a *)s)[5];
+		u32 h = ((u32a *)s)[6], i = ((u32a *)s)[7];
+
+		((u32a *)d)[0] = a;
+		((u32a *)d)[1] = b;
+		((u32a *)d)[2] = c;
+		((u32a *)d)[3] = e;
+		((u32a *)d)[4] = f;
+		((u32a *)d)[5] = g;
+		((u32a *)d)[6] = h;
+		((u32a *)d)[7] = i;
+	}
+	for (; n >= 4; n -= 4, d += 4, s += 4)
+		*(u32a *)d = *(u32a *)s;
+}
+
+/* Ascending, also used for memmove() to a lower address */
+static void copy_forward(u8 *d, const u8 *s, size_t n)
+{
+	unsigned int shift;
+	const u32a *sw;
+	u32 cur, next;
+
+	for (; n && ((unsigned long)d & 3); n--)
+		*d++ = *s++;
+
+	if (!((unsigned long)s & 3)) {
+		copy_words_forward(d, s, n);
+		d += n & ~3;
+		s += n & ~3;
+		n &= 3;
+	} else if (n >= 4) {
+		/*
+		 * Every aligned word read holds at least one byte of the
+		 * source, so this never reads past what the caller owns.
+		 */
+		shift = ((unsigned long)s & 3) * 8;
+		sw = (const u32a *)((unsigned long)s & ~3UL);
+		cur = *sw++;
+		for (; n >= 4; n -= 4, d += 4, s += 4) {
+			next = *sw++;
+			*(u32a *)d = cur >> shift | next << (32 - shift);
+			cur = next;
+		}
+	}
+
+	for (; n; n--)
+		*d++ = *s++;
+}
+
+/* Descending, for memmove() to a higher address */
+static void copy_backward(u8 *d, const u8 *s, size_t n)
+{
+	d += n;
+	s += n;
+	for (; n && ((unsigned long)d & 3); n--)
+		*--d = *--s;
+
+	if (!((unsigned long)s & 3)) {
+		for (; n >= 32; n -= 32) {
+			u32 a, b, c, e, f, g, h, i;
+
+			d -= 32;
+			s -= 32;
+			a = ((u32a *)s)[7];
+			b = ((u32a *)s)[6];
+			c = ((u32a *)s)[5];
+			e = ((u32a *)s)[4];
+			f = ((u32a *)s)[3];
+			g = ((u32a *)s)[2];
+			h = ((u32a *)s)[1];
+			i = ((u32a *)s)[0];
+			((u32a *)d)[7] = a;
+			((u32a *)d)[6] = b;
+			((u32a *)d)[5] = c;
+			((u32a *)d)[4] = e;
+			((u32a *)d)[3] = f;
+			((u32a *)d)[2] = g;
+			((u32a *)d)[1] = h;
+			((u32a *)d)[0] = i;
+		}
+		for (; n >= 4; n -= 4) {
+			d -= 4;
+			s -= 4;
+			*(u32a *)d = *(u32a *)s;
+		}
+	}
+
+	for (; n; n--)
+		*--d = *--s;
+}
+
+/**
+ * memcpy - Copy one area of memory to another
+ * @dest: Where to copy to
+ * @src: Where to copy from
+ * @count: The size of the area.
+ */
+#undef memcpy
+void *memcpy(void *dest, const void *src, size_t count)
+{
+	copy_forward(dest, src, count);
+	return dest;
+}
+EXPORT_SYMBOL(memcpy);
+
+/**
+ * memmove - Copy one area of memory to another
+ * @dest: Where to copy to
+ * @src: Where to copy from
+ * @count: The size of the area.
+ *
+ * Unlike memcpy(), memmove() copes with overlapping areas.
+ */
+void *memmove(void *dest, const void *src, size_t count)
+{
+	if (dest <= src)
+		copy_forward(dest, src, count);
+	else
+		copy_backward(dest, src, count);
+	return dest;
+}
+EXPORT_SYMBOL(memmove);
+
+/**
+ * memset - Fill a region of memory with the given value
+ * @s: Pointer to the start of the area.
+ * @c: The byte to fill the area with
+ * @count: The size of the area.
+ */
+#undef memset
+void *memset(void *s, int c, size_t count)
+{
+	u32 v = (u8)c * 0x01010101U;
+	u8 *d = s;
+
+	for (; count && ((unsigned long)d & 3); count--)
+		*d++ = c;
+	for (; count >= 32; count -= 32, d += 32) {
+		((u32a *)d)[0] = v;
+		((u32a *)d)[1] = v;
+		((u32a *)d)[2] = v;
+		((u32a *)d)[3] = v;
+		((u32a *)d)[4] = v;
+		((u32a *)d)[5] = v;
+		((u32a *)d)[6] = v;
+		((u32a *)d)[7] = v;
+	}
+	for (; count >= 4; count -= 4, d += 4)
+		*(u32a *)d = v;
+	for (; count; count--)
+		*d++ = c;
+	return s;
+}
+EXPORT_SYMBOL(memset);
+
+/*
+ * The I/O side is accessed naturally aligned, which Device memory
+ * requires, a word at a time in between.
+ */
+static __always_inline void store_io(void *d, const void *s, size_t size)
+{
+	switch (size) {
+	case 1:
+		*(volatile u8 *)d = *(const u8 *)s;
+		break;
+	case 2:
+		*(volatile u16 *)d = get_unaligned((const u16 *)s);
+		break;
+	case 4:
+		*(volatile u32 *)d = get_unaligned((const u32 *)s);
+		break;
+	}
+}
+
+/* With @fill, @s is a word pattern that is stored over and over */
+static __always_inline void write_io(void *d, const void *s, size_t n,
+				     bool fill)
+{
+	size_t size;
+
+	for (size = 1; size < 4; size *= 2) {
+		if (n >= size && ((unsigned long)d & size)) {
+			store_io(d, s, size);
+			d += size;
+			s += fill ? 0 : size;
+			n -= size;
+		}
+	}
+	for (size = 4; size; size /= 2) {
+		for (; n >= size; n -= size, d += size, s += fill ? 0 : size)
+			store_io(d, s, size);
+	}
+}
+
+static __always_inline void load_io(void *d, const void *s, size_t size)
+{
+	switch (size) {
+	case 1:
+		*(u8 *)d = *(const volatile u8 *)s;
+		break;
+	case 2:
+		put_unaligned(*(const volatile u16 *)s, (u16 *)d);
+		break;
+	case 4:
+		put_unaligned(*(const volatile u32 *)s, (u32 *)d);
+		break;
+	}
+}
+
+/**
+ * memcpy_fromio - Copy from I/O memory
+ * @dest: Where to copy to
+ * @src: Where to copy from, in I/O memory
+ * @count: The size of the area.
+ */
+void memcpy_fromio(void *dest, const volatile void __iomem *src, size_t count)
+{
+	const void *s = (const void __force *)src;
+	size_t size;
+
+	for (size = 1; size < 4; size *= 2) {
+		if (count >= size && ((unsigned long)s & size)) {
+			load_io(dest, s, size);
+			dest += size;
+			s += size;
+			count -= size;
+		}
+	}
+	for (size = 4; size; size /= 2) {
+		for (; count >= size; count -= size, dest += size, s += size)
+			load_io(dest, s, size);
+	}
+}
+EXPORT_SYMBOL(memcpy_fromio);
+
+/**
+ * memcpy_toio - Copy to I/O memory
+ * @dest: Where to copy to, in I/O memory
+ * @src: Where to copy from
+ * @count: The size of the area.
+ */
+void memcpy_toio(volatile void __iomem *dest, const void *src, size_t count)
+{
+	write_io((void __force *)dest, src, count, false);
+	asm volatile("dmb st" : : : "memory");
+}
+EXPORT_SYMBOL(memcpy_toio);
+
+/**
+ * memset_io - Fill I/O memory with the given value
+ * @s: Pointer to the start of the area, in I/O memory
+ * @c: The byte to fill the area with
+ * @count: The size of the area.
+ */
+void memset_io(volatile void __iomem *s, int c, size_t count)
+{
+	u32 v = (u8)c * 0x01010101U;
+
+	write_io((void __force *)s, &v, count, true);
+	asm volatile("dmb st" : : : "memory");
+}
+EXPORT_SYMBOL(memset_io);
@@ -0,0 +1,1082 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Memory and string functions for X64
+ *
+ * SSE2 is always there on X64, the 16 byte loops are the baseline. CPUs
+ * with ERMS get "rep movsb" and "rep stosb" for the middle sizes, and
+ * copies and fills of at least STRING_NT_THRESHOLD bytes use non-temporal
+ * stores, so that moving a kernel image or a framebuffer does not evict
+ * everything else from the caches. strspn() and friends use SSSE3 when
+ * the CPU has it. The variant is picked on first use.
+ *
+ * Nothing wider than SSE is used: the firmware's interrupt entry saves
+ * the vector registers with FXSAVE, which does not cover the upper halves
+ * of the AVX registers.
+ *
+ * Blocks of 16 bytes and more are copied by loading the first and last
+ * 16 bytes up front, storing them last and moving the rest through
+ * aligned stores in between. Loads always precede the stores of the same
+ * block, which is what makes the forward loop usable for memmove() to a
+ * lower address.
+ */
+
+#include <LinuxBase.h>
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/export.h>
+#include <linux/compiler.h>
+#include <linux/kernel.h>
+#include <linux/bitops.h>
+#include <linux/ctype.h>
+#include <linux/io.h>
+
+#include <asm/page.h>
+
+#define STRING_NT_THRESHOLD	(1024 * 1024)
+/* Below this, "rep movsb" is slower than the vector loop */
+#define STRING_ERMS_THRESHOLD	512
+#define STRING_FSRM_THRESHOLD	128
+
+#define X86_STRING_PROBED	BIT(0)
+#define X86_STRING_ERMS		BIT(1)
+#define X86_STRING_FSRM		BIT(2)
+#define X86_STRING_SSSE3	BIT(3)
+
+#define __sse2	__attribute__((target("sse2")))
+#define __ssse3	__attribute__((target("ssse3")))
+
+typedef long long v16 __attribute__((vector_size(16), aligned(16), may_alias));
+typedef long long v16u __attribute__((vector_size(16), aligned(1), may_alias));
+typedef u64 u64u __attribute__((aligned(1), may_alias));
+typedef u32 u32u __attribute__((aligned(1), may_alias));
+typedef u16 u16u __attribute__((aligned(1), may_alias));
+
+static unsigned int x86_string_caps;
+
+static void cpuid_count(u32 op, u32 count, u32 *eax, u32 *ebx, u32 *ecx,
+			u32 *edx)
+{
+	asm volatile("cpuid"
+		     : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+		     : "0" (op), "2" (count));
+}
+
+static noinline unsigned int x86_string_probe(void)
+{
+	unsigned int caps = X86_STRING_PROBED;
+	u32 eax, ebx, ecx, edx;
+
+	cpuid_count(0, 0, &eax, &ebx, &ecx, &edx);
+	if (eax >= 1) {
+		u32 max = eax;
+
+		cpuid_count(1, 0, &eax, &ebx, &ecx, &edx);
+		if (ecx & BIT(9))
+			caps |= X86_STRING_SSSE3;
+		eax = max;
+	}
+	if (eax >= 7) {
+		cpuid_count(7, 0, &eax, &ebx, &ecx, &edx);
+		if (ebx & BIT(9))
+			caps |= X86_STRING_ERMS;
+		if (edx & BIT(4))
+			caps |= X86_STRING_FSRM;
+	}
+
+	/* Racing probes store the same value */
+	WRITE_ONCE(x86_string_caps, caps);
+	return caps;
+}
+
+static __always_inline unsigned int x86_string_get_caps(void)
+{
+	unsigned int caps = READ_ONCE(x86_string_caps);
+
+	if (unlikely(!caps))
+		caps = x86_string_probe();
+	return caps;
+}
+
+static __always_inline size_t x86_string_erms_threshold(unsigned int caps)
+{
+	if (!(caps & X86_STRING_ERMS))
+		return STRING_NT_THRESHOLD;
+	if (caps & X86_STRING_FSRM)
+		return STRING_FSRM_THRESHOLD;
+	return STRING_ERMS_THRESHOLD;
+}
+
+/* Up to 32 bytes, everything is loaded before anything is stored */
+static __sse2 __always_inline void copy_small(void *dest, const void *src,
+					      size_t n)
+{
+	if (n >= 16) {
+		v16 a = *(v16u *)src;
+		v16 b = *(v16u *)(src + n - 16);
+
+		*(v16u *)dest = a;
+		*(v16u *)(dest + n - 16) = b;
+	} else if (n >= 8) {
+		u64 a = *(u64u *)src;
+		u64 b = *(u64u *)(src + n - 8);
+
+		*(u64u *)dest = a;
+		*(u64u *)(dest + n - 8) = b;
+	} else if (n >= 4) {
+		u32 a = *(u32u *)src;
+		u32 b = *(u32u *)(src + n - 4);
+
+		*(u32u *)dest = a;
+		*(u32u *)(dest + n - 4) = b;
+	} else if (n) {
+		u8 a = *(u8 *)src;
+		u8 b = *(u8 *)(src + n / 2);
+		u8 c = *(u8 *)(src + n - 1);
+
+		*(u8 *)dest = a;
+		*(u8 *)(dest + n / 2) = b;
+		*(u8 *)(dest + n - 1) = c;
+	}
+}
+
+/* More than 32 bytes, ascending */
+static __sse2 noinline void copy_forward(void *dest, const void *src,
+					 size_t n)
+{
+	v16 head = *(v16u *)src;
+	v16 tail = *(v16u *)(src + n - 16);
+	void *d = PTR_ALIGN(dest + 1, 16);
+	const void *s = src + (d - dest);
+	void *end = dest + n - 16;
+
+	for (; d + 64 <= end; d += 64, s += 64) {
+		v16 a = ((v16u *)s)[0];
+		v16 b = ((v16u *)s)[1];
+		v16 c = ((v16u *)s)[2];
+		v16 e = ((v16u *)s)[3];
+
+		((v16 *)d)[0] = a;
+		((v16 *)d)[1] = b;
+		((v16 *)d)[2] = c;
+		((v16 *)d)[3] = e;
+	}
+	for (; d < end; d += 16, s += 16)
+		*(v16 *)d = *(v16u *)s;
+
+	*(v16u *)end = tail;
+	*(v16u *)dest = head;
+}
+
+/* More than 32 bytes, descending, for memmove() to a higher address */
+static __sse2 noinline void copy_backward(void *dest, const void *src,
+					  size_t n)
+{
+	v16 head = *(v16u *)src;
+	v16 tail = *(v16u *)(src + n - 16);
+	void *d = (void *)ALIGN_DOWN((unsigned long)dest + n - 1, 16);
+	const void *s = src + (d - dest);
+
+	while (d - dest > 64 + 16) {
+		v16 a, b, c, e;
+
+		d -= 64;
+		s -= 64;
+		a = ((v16u *)s)[3];
+		b = ((v16u *)s)[2];
+		c = ((v16u *)s)[1];
+		e = ((v16u *)s)[0];
+		((v16 *)d)[3] = a;
+		((v16 *)d)[2] = b;
+		((v16 *)d)[1] = c;
+		((v16 *)d)[0] = e;
+	}
+	while (d - dest > 16) {
+		d -= 16;
+		s -= 16;
+		*(v16 *)d = *(v16u *)s;
+	}
+
+	*(v16u *)dest = head;
+	*(v16u *)(dest + n - 16) = tail;
+}
+
+/* Stores around the cache, the destinations must not overlap the source */
+static __sse2 noinline void copy_nt(void *dest, const void *src, size_t n)
+{
+	v16 head = *(v16u *)src;
+	v16 tail = *(v16u *)(src + n - 16);
+	void *d = PTR_ALIGN(dest + 1, 16);
+	const void *s = src + (d - dest);
+	void *end = dest + n - 16;
+
+	for (; d + 64 <= end; d += 64, s += 64) {
+		v16 a = ((v16u *)s)[0];
+		v16 b = ((v16u *)s)[1];
+		v16 c = ((v16u *)s)[2];
+		v16 e = ((v16u *)s)[3];
+
+		__builtin_ia32_movntdq((v16 *)d, a);
+		__builtin_ia32_movntdq((v16 *)d + 1, b);
+		__builtin_ia32_movntdq((v16 *)d + 2, c);
+		__builtin_ia32_movntdq((v16 *)d + 3, e);
+	}
+	for (; d < end; d += 16, s += 16)
+		__builtin_ia32_movntdq((v16 *)d, *(v16u *)s);
+	/* Order the streaming stores before anything that follows */
+	__builtin_ia32_sfence();
+
+	*(v16u *)end = tail;
+	*(v16u *)dest = head;
+}
+
+static __always_inline void rep_movsb(void *dest, const void *src, size_t n)
+{
+	asm volatile("rep movsb"
+		     : "+D" (dest), "+S" (src), "+c" (n)
+		     : : "memory");
+}
+
+static __always_inline void rep_stosb(void *dest, int c, size_t n)
+{
+	asm volatile("rep stosb"
+		     : "+D" (dest), "+c" (n)
+		     : "a" (c) : "memory");
+}
+
+static void copy_large(void *dest, const void *src, size_t n,
+		       unsigned int caps)
+{
+	if (n >= STRING_NT_THRESHOLD)
+		copy_nt(dest, src, n);
+	else if (n >= x86_string_erms_threshold(caps))
+		rep_movsb(dest, src, n);
+	else
+		copy_forward(dest, src, n);
+}
+
+/**
+ * memcpy - Copy one area of memory to another
+ * @dest: Where to copy to
+ * @src: Where to copy from
+ * @count: The size of the area.
+ */
+#undef memcpy
+__sse2 void *memcpy(void *dest, const void *src, size_t count)
+{
+	if (count <= 32)
+		copy_small(dest, src, count);
+	else
+		copy_large(dest, src, count, x86_string_get_caps());
+	return dest;
+}
+EXPORT_SYMBOL(memcpy);
+
+/**
+ * memmove - Copy one area of memory to another
+ * @dest: Where to copy to
+ * @src: Where to copy from
+ * @count: The size of the area.
+ *
+ * Unlike memcpy(), memmove() copes with overlapping areas.
+ */
+__sse2 void *memmove(void *dest, const void *src, size_t count)
+{
+	if (count <= 32)
+		copy_small(dest, src, count);
+	else if (src + count <= dest || dest + count <= src)
+		copy_large(dest, src, count, x86_string_get_caps());
+	else if (dest < src)
+		copy_forward(dest, src, count);
+	else if (dest > src)
+		copy_backward(dest, src, count);
+	return dest;
+}
+EXPORT_SYMBOL(memmove);
+
+static __sse2 noinline void fill_forward(void *s, v16 v, size_t n)
+{
+	void *d = PTR_ALIGN(s + 1, 16);
+	void *end = s + n - 16;
+
+	*(v16u *)s = v;
+	for (; d + 64 <= end; d += 64) {
+		((v16 *)d)[0] = v;
+		((v16 *)d)[1] = v;
+		((v16 *)d)[2] = v;
+		((v16 *)d)[3] = v;
+	}
+	for (; d < end; d += 16)
+		*(v16 *)d = v;
+	*(v16u *)end = v;
+}
+
+static __sse2 noinline void fill_nt(void *s, v16 v, size_t n)
+{
+	void *d = PTR_ALIGN(s + 1, 16);
+	void *end = s + n - 16;
+
+	*(v16u *)s = v;
+	for (; d + 64 <= end; d += 64) {
+		__builtin_ia32_movntdq((v16 *)d, v);
+		__builtin_ia32_movntdq((v16 *)d + 1, v);
+		__builtin_ia32_movntdq((v16 *)d + 2, v);
+		__builtin_ia32_movntdq((v16 *)d + 3, v);
+	}
+	for (; d < end; d += 16)
+		__builtin_ia32_movntdq((v16 *)d, v);
+	__builtin_ia32_sfence();
+	*(v16u *)end = v;
+}
+
+/*
+ * Fill at least two bytes with a repeating @pattern. memset16() and
+ * friends pass a multiple of the element size and @s aligned to it, so
+ * the overlapping and aligned stores all stay in phase.
+ */
+static __sse2 __always_inline void fill_pattern(void *s, u64 pattern,
+						size_t n)
+{
+	v16 v = (v16){ pattern, pattern };
+
+	if (n > 32) {
+		if (n >= STRING_NT_THRESHOLD)
+			fill_nt(s, v, n);
+		else
+			fill_forward(s, v, n);
+	} else if (n >= 16) {
+		*(v16u *)s = v;
+		*(v16u *)(s + n - 16) = v;
+	} else if (n >= 8) {
+		*(u64u *)s = pattern;
+		*(u64u *)(s + n - 8) = pattern;
+	} else if (n >= 4) {
+		*(u32u *)s = pattern;
+		*(u32u *)(s + n - 4) = pattern;
+	} else {
+		*(u16u *)s = pattern;
+	}
+}
+
+/**
+ * memset - Fill a region of memory with the given value
+ * @s: Pointer to the start of the area.
+ * @c: The byte to fill the area with
+ * @count: The size of the area.
+ */
+#undef memset
+__sse2 void *memset(void *s, int c, size_t count)
+{
+	if (count > 32 && count < STRING_NT_THRESHOLD &&
+	    count >= x86_string_erms_threshold(x86_string_get_caps())) {
+		rep_stosb(s, c, count);
+	} else if (count >= 4) {
+		fill_pattern(s, (u8)c * 0x0101010101010101ULL, count);
+	} else if (count) {
+		*(u8 *)s = c;
+		*(u8 *)(s + count / 2) = c;
+		*(u8 *)(s + count - 1) = c;
+	}
+	return s;
+}
+EXPORT_SYMBOL(memset);
+
+/**
+ * memset16() - Fill a memory area with a uint16_t
+ * @s: Pointer to the start of the area.
+ * @v: The value to fill the area with
+ * @count: The number of values to store
+ */
+__sse2 void *memset16(uint16_t *s, uint16_t v, size_t count)
+{
+	if (count)
+		fill_pattern(s, v * 0x0001000100010001ULL, count * 2);
+	return s;
+}
+EXPORT_SYMBOL(memset16);
+
+/**
+ * memset32() - Fill a memory area with a uint32_t
+ * @s: Pointer to the start of the area.
+ * @v: The value to fill the area with
+ * @count: The number of values to store
+ */
+__sse2 void *memset32(uint32_t *s, uint32_t v, size_t count)
+{
+	if (count)
+		fill_pattern(s, v * 0x0000000100000001ULL, count * 4);
+	return s;
+}
+EXPORT_SYMBOL(memset32);
+
+/**
+ * memset64() - Fill a memory area with a uint64_t
+ * @s: Pointer to the start of the area.
+ * @v: The value to fill the area with
+ * @count: The number of values to store
+ */
+__sse2 void *memset64(uint64_t *s, uint64_t v, size_t count)
+{
+	if (count)
+		fill_pattern(s, v, count * 8);
+	return s;
+}
+EXPORT_SYMBOL(memset64);
+
+/*
+ * The scans read aligned 16 byte blocks, starting with the one holding
+ * the first byte. A block holding a byte the caller may read cannot
+ * cross a page boundary, and a scan stops at the first block with a hit.
+ */
+typedef char v16b __attribute__((vector_size(16), aligned(16), may_alias));
+typedef char v16bu __attribute__((vector_size(16), aligned(1), may_alias));
+typedef unsigned short v8hu __attribute__((vector_size(16), aligned(16), may_alias));
+
+static __sse2 __always_inline unsigned int block_eq(const v16b *p, v16b c)
+{
+	return __builtin_ia32_pmovmskb128(*p == c);
+}
+
+static __sse2 __always_inline unsigned int block_eq2(const v16b *p, v16b c)
+{
+	v16b v = *p;
+
+	return __builtin_ia32_pmovmskb128((v == c) | (v == (v16b){}));
+}
+
+/* Find the first byte of a string that is either NUL or @c */
+static __sse2 const char *strchrnul_sse2(const char *s, int c)
+{
+	const v16b *p = (const v16b *)((unsigned long)s & ~15UL);
+	v16b cv = (v16b){} + (char)c;
+	unsigned int mask;
+
+	mask = block_eq2(p, cv) >> ((unsigned long)s & 15);
+	if (mask)
+		return s + __builtin_ctz(mask);
+
+	do
+		mask = block_eq2(++p, cv);
+	while (!mask);
+
+	return (const char *)p + __builtin_ctz(mask);
+}
+
+/* Find the first @c in an area, %NULL if there is none */
+static __sse2 const void *memchr_sse2(const void *s, int c, size_t n)
+{
+	const v16b *p = (const v16b *)((unsigned long)s & ~15UL);
+	unsigned long end = (unsigned long)s + n;
+	v16b cv = (v16b){} + (char)c;
+	const void *ret;
+	unsigned int mask;
+
+	if (!n)
+		return NULL;
+	if (end < (unsigned long)s)
+		end = ULONG_MAX;
+
+	mask = block_eq(p, cv) >> ((unsigned long)s & 15);
+	if (mask) {
+		ret = s + __builtin_ctz(mask);
+	} else {
+		do {
+			if ((unsigned long)++p >= end)
+				return NULL;
+			mask = block_eq(p, cv);
+		} while (!mask);
+		ret = (const void *)p + __builtin_ctz(mask);
+	}
+
+	return (unsigned long)ret < end ? ret : NULL;
+}
+
+/**
+ * strlen - Find the length of a string
+ * @s: The string to be sized
+ */
+#undef strlen
+__sse2 size_t strlen(const char *s)
+{
+	return strchrnul_sse2(s, 0) - s;
+}
+EXPORT_SYMBOL(strlen);
+
+/**
+ * strnlen - Find the length of a length-limited string
+ * @s: The string to be sized
+ * @count: The maximum number of bytes to search
+ */
+__sse2 size_t strnlen(const char *s, size_t count)
+{
+	const char *sc = memchr_sse2(s, 0, count);
+
+	return sc ? sc - s : count;
+}
+EXPORT_SYMBOL(strnlen);
+
+/**
+ * strchr - Find the first occurrence of a character in a string
+ * @s: The string to be searched
+ * @c: The character to search for
+ */
+__sse2 char *strchr(const char *s, int c)
+{
+	s = strchrnul_sse2(s, c);
+	return *s == (char)c ? (char *)s : NULL;
+}
+EXPORT_SYMBOL(strchr);
+
+/**
+ * strchrnul - Find and return a character in a string, or end of string
+ * @s: The string to be searched
+ * @c: The character to search for
+ *
+ * Returns pointer to first occurrence of 'c' in s. If c is not found, then
+ * return a pointer to the null byte at the end of s.
+ */
+__sse2 char *strchrnul(const char *s, int c)
+{
+	return (char *)strchrnul_sse2(s, c);
+}
+EXPORT_SYMBOL(strchrnul);
+
+/**
+ * memchr - Find a character in an area of memory.
+ * @s: The memory area
+ * @c: The byte to search for
+ * @n: The size of the area.
+ *
+ * returns the address of the first occurrence of @c, or %NULL
+ * if @c is not found
+ */
+__sse2 void *memchr(const void *s, int c, size_t n)
+{
+	return (void *)memchr_sse2(s, c, n);
+}
+EXPORT_SYMBOL(memchr);
+
+/**
+ * memscan - Find a character in an area of memory.
+ * @addr: The memory area
+ * @c: The byte to search for
+ * @size: The size of the area.
+ *
+ * returns the address of the first occurrence of @c, or 1 byte past
+ * the area if @c is not found
+ */
+__sse2 void *memscan(void *addr, int c, size_t size)
+{
+	const void *p = memchr_sse2(addr, c, size);
+
+	return p ? (void *)p : addr + size;
+}
+EXPORT_SYMBOL(memscan);
+
+/*
+ * Byte sets for strspn() and friends, as nibble tables: bit h of lo[l]
+ * is set when the byte h << 4 | l is in the set, for h < 8, and hi[l]
+ * does the same for h >= 8. pshufb yields zero for an index with the top
+ * bit set, which picks the table, and a third lookup by the high nibble
+ * gives the bit to test. That takes SSSE3, without it the set is a plain
+ * 256 bit map.
+ */
+struct byteset {
+	u8 lo[16];
+	u8 hi[16];
+} __aligned(16);
+
+static __ssse3 __always_inline unsigned int block_in(const v16b *p, v16b lo,
+						     v16b hi, v16b bits)
+{
+	v16b v = *p;
+	v16b row = __builtin_ia32_pshufb128(lo, v) |
+		   __builtin_ia32_pshufb128(hi, v ^ (char)0x80);
+	v16b col = __builtin_ia32_pshufb128(bits, (v16b)((v8hu)v >> 4) & 15);
+
+	return __builtin_ia32_pmovmskb128((row & col) != 0);
+}
+
+static __ssse3 noinline size_t strspn_ssse3(const char *s,
+					     const struct byteset *set,
+					     bool reject)
+{
+	const v16b *p = (const v16b *)((unsigned long)s & ~15UL);
+	v16b lo = *(const v16b *)set->lo;
+	v16b hi = *(const v16b *)set->hi;
+	v16b bits = { 1, 2, 4, 8, 16, 32, 64, -128,
+		      1, 2, 4, 8, 16, 32, 64, -128 };
+	unsigned int flip = reject ? 0 : 0xffff;
+	unsigned int mask;
+
+	mask = (block_in(p, lo, hi, bits) ^ flip) >> ((unsigned long)s & 15);
+	if (mask)
+		return __builtin_ctz(mask);
+
+	do
+		mask = block_in(++p, lo, hi, bits) ^ flip;
+	while (!mask);
+
+	return (const char *)p + __builtin_ctz(mask) - s;
+}
+
+/*
+ * Length of the initial run of @s made of bytes in @chars, or with
+ * @reject of bytes not in it. NUL is added to the set for @reject, so
+ * either way the scan stops at the end of @s.
+ */
+static __sse2 size_t __strspn(const char *s, const char *chars, bool reject)
+{
+	const unsigned char *p = (const unsigned char *)chars;
+	unsigned long map[256 / BITS_PER_LONG] = { 0 };
+	struct byteset set = { };
+
+	if (!p[0])
+		return reject ? strchrnul_sse2(s, 0) - s : 0;
+	if (reject && !p[1])
+		return strchrnul_sse2(s, p[0]) - s;
+
+	if (x86_string_get_caps() & X86_STRING_SSSE3) {
+		for (; *p; p++) {
+			u8 *row = *p & 0x80 ? set.hi : set.lo;
+
+			row[*p & 15] |= 1 << (*p >> 4 & 7);
+		}
+		if (reject)
+			set.lo[0] |= 1;
+		return strspn_ssse3(s, &set, reject);
+	}
+
+	for (; *p; p++)
+		map[BIT_WORD(*p)] |= BIT_MASK(*p);
+	if (reject)
+		map[0] |= 1;
+
+	for (p = (const unsigned char *)s;
+	     !!(map[BIT_WORD(*p)] & BIT_MASK(*p)) != reject; p++)
+		;
+	return p - (const unsigned char *)s;
+}
+
+/**
+ * strspn - Calculate the length of the initial substring of @s which only contain letters in @accept
+ * @s: The string to be searched
+ * @accept: The string to search for
+ */
+__sse2 size_t strspn(const char *s, const char *accept)
+{
+	return __strspn(s, accept, false);
+}
+EXPORT_SYMBOL(strspn);
+
+/**
+ * strcspn - Calculate the length of the initial substring of @s which does not contain letters in @reject
+ * @s: The string to be searched
+ * @reject: The string to avoid
+ */
+__sse2 size_t strcspn(const char *s, const char *reject)
+{
+	return __strspn(s, reject, true);
+}
+EXPORT_SYMBOL(strcspn);
+
+/**
+ * strpbrk - Find the first occurrence of a set of characters
+ * @cs: The string to be searched
+ * @ct: The characters to search for
+ */
+__sse2 char *strpbrk(const char *cs, const char *ct)
+{
+	cs += __strspn(cs, ct, true);
+	return *cs ? (char *)cs : NULL;
+}
+EXPORT_SYMBOL(strpbrk);
+
+/*
+ * Offset of the first 16 byte block in the first @n bytes, a multiple of
+ * 16, whose bytes differ after folding ASCII case or which has a NUL in
+ * @s1, or @n if there is none.
+ */
+static __sse2 size_t strcasediff_sse2(const char *s1, const char *s2,
+				      size_t n)
+{
+	v16b lo = (v16b){} + ('A' - 1), hi = (v16b){} + ('Z' + 1);
+	v16b bit = (v16b){} + 0x20;
+	size_t i;
+
+	for (i = 0; i < n; i += 16) {
+		v16b a = *(v16bu *)(s1 + i);
+		v16b b = *(v16bu *)(s2 + i);
+
+		/* Bytes from 0x80 are negative and never upper case */
+		a |= (a > lo) & (a < hi) & bit;
+		b |= (b > lo) & (b < hi) & bit;
+		if (__builtin_ia32_pmovmskb128((a != b) | (a == (v16b){})))
+			break;
+	}
+	return i;
+}
+
+/*
+ * Case insensitive compare of at most @len bytes. strcasediff_sse2() skips blocks
+ * of 16 bytes that match after folding ASCII case and hold no NUL, as
+ * long as neither string can run into the next page. The block it stops
+ * at goes through tolower(), which knows Latin-1 as well.
+ */
+static __sse2 int __strncasecmp(const char *s1, const char *s2, size_t len)
+{
+	/* Yes, Virginia, it had better be unsigned */
+	unsigned char c1, c2;
+	size_t n;
+
+	while (len) {
+		n = min3(len, PAGE_SIZE - ((unsigned long)s1 & ~PAGE_MASK),
+			 PAGE_SIZE - ((unsigned long)s2 & ~PAGE_MASK)) & ~15UL;
+		if (n) {
+			n = strcasediff_sse2(s1, s2, n);
+			s1 += n;
+			s2 += n;
+			len -= n;
+		}
+
+		for (n = min_t(size_t, len, 16), len -= n; n; n--) {
+			c1 = *s1++;
+			c2 = *s2++;
+			if (!c1 || !c2)
+				return (int)c1 - (int)c2;
+			if (c1 == c2)
+				continue;
+			c1 = tolower(c1);
+			c2 = tolower(c2);
+			if (c1 != c2)
+				return (int)c1 - (int)c2;
+		}
+	}
+	return 0;
+}
+
+/**
+ * strncasecmp - Case insensitive, length-limited string comparison
+ * @s1: One string
+ * @s2: The other string
+ * @len: the maximum number of characters to compare
+ */
+__sse2 int strncasecmp(const char *s1, const char *s2, size_t len)
+{
+	return __strncasecmp(s1, s2, len);
+}
+EXPORT_SYMBOL(strncasecmp);
+
+__sse2 int strcasecmp(const char *s1, const char *s2)
+{
+	return __strncasecmp(s1, s2, SIZE_MAX);
+}
+EXPORT_SYMBOL(strcasecmp);
+
+/* Up to 16 bytes, index of the first byte that differs or @n */
+static __always_inline size_t memdiff_small(const void *a, const void *b,
+					    size_t n)
+{
+	u64 x;
+	u32 y;
+	size_t i;
+
+	if (n >= 8) {
+		x = *(u64u *)a ^ *(u64u *)b;
+		if (x)
+			return __builtin_ctzll(x) / 8;
+		x = *(u64u *)(a + n - 8) ^ *(u64u *)(b + n - 8);
+		return x ? n - 8 + __builtin_ctzll(x) / 8 : n;
+	}
+	if (n >= 4) {
+		y = *(u32u *)a ^ *(u32u *)b;
+		if (y)
+			return __builtin_ctz(y) / 8;
+		y = *(u32u *)(a + n - 4) ^ *(u32u *)(b + n - 4);
+		return y ? n - 4 + __builtin_ctz(y) / 8 : n;
+	}
+	for (i = 0; i < n; i++)
+		if (((u8 *)a)[i] != ((u8 *)b)[i])
+			break;
+	return i;
+}
+
+/*
+ * Index of the first byte that differs between two areas, or @n. The
+ * last block overlaps the one before it, whose bytes are known to match.
+ */
+static __sse2 size_t memdiff_sse2(const void *a, const void *b, size_t n)
+{
+	size_t i;
+	unsigned int mask;
+
+	if (n <= 16)
+		return memdiff_small(a, b, n);
+
+	for (i = 0; i < n - 16; i += 16) {
+		mask = __builtin_ia32_pmovmskb128(*(v16bu *)(a + i) !=
+						  *(v16bu *)(b + i));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	i = n - 16;
+	mask = __builtin_ia32_pmovmskb128(*(v16bu *)(a + i) !=
+					  *(v16bu *)(b + i));
+	return mask ? i + __builtin_ctz(mask) : n;
+}
+
+/**
+ * memcmp - Compare two areas of memory
+ * @cs: One area of memory
+ * @ct: Another area of memory
+ * @count: The size of the area.
+ */
+#undef memcmp
+__sse2 int memcmp(const void *cs, const void *ct, size_t count)
+{
+	size_t i = memdiff_sse2(cs, ct, count);
+
+	return i < count ? ((u8 *)cs)[i] - ((u8 *)ct)[i] : 0;
+}
+EXPORT_SYMBOL(memcmp);
+
+/* Out of line part of memeq() */
+__sse2 bool __memeq(const void *cs, const void *ct, size_t count)
+{
+	return memdiff_sse2(cs, ct, count) == count;
+}
+EXPORT_SYMBOL(__memeq);
+
+/* Mask of the bytes of an unaligned 16 byte block other than @c */
+static __sse2 __always_inline unsigned int block_ne(const void *p, v16b c)
+{
+	return __builtin_ia32_pmovmskb128(*(const v16bu *)p != c);
+}
+
+/**
+ * memchr_inv - Find an unmatching character in an area of memory.
+ * @start: The memory area
+ * @c: Find a character other than c
+ * @bytes: The size of the area.
+ *
+ * returns the address of the first character other than @c, or %NULL
+ * if the whole buffer contains just @c.
+ *
+ * The middle goes 64 bytes at a time through aligned loads. A 64 byte
+ * block with a mismatch is looked at again 16 bytes at a time, the masks
+ * of which give the position.
+ */
+__sse2 void *memchr_inv(const void *start, int c, size_t bytes)
+{
+	u64 pattern = (u8)c * 0x0101010101010101ULL;
+	v16b cv = (v16b){} + (char)c;
+	const void *p, *end;
+	unsigned int mask;
+	u64 x;
+
+	if (bytes < 8) {
+		for (p = start; p < start + bytes; p++)
+			if (*(u8 *)p != (u8)c)
+				return (void *)p;
+		return NULL;
+	}
+	if (bytes < 16) {
+		p = start;
+		x = *(u64u *)p ^ pattern;
+		if (!x) {
+			p = start + bytes - 8;
+			x = *(u64u *)p ^ pattern;
+		}
+		return x ? (void *)p + __builtin_ctzll(x) / 8 : NULL;
+	}
+
+	mask = block_ne(start, cv);
+	if (mask)
+		return (void *)start + __builtin_ctz(mask);
+
+	p = PTR_ALIGN(start + 1, 16);
+	end = start + bytes - 16;
+	for (; p + 64 <= end; p += 64) {
+		const v16b *b = p;
+
+		if (__builtin_ia32_pmovmskb128((b[0] == cv) & (b[1] == cv) &
+					       (b[2] == cv) & (b[3] == cv)) !=
+		    0xffff)
+			break;
+	}
+	for (; p < end; p += 16) {
+		mask = block_ne(p, cv);
+		if (mask)
+			return (void *)p + __builtin_ctz(mask);
+	}
+
+	mask = block_ne(end, cv);
+	return mask ? (void *)end + __builtin_ctz(mask) : NULL;
+}
+EXPORT_SYMBOL(memchr_inv);
+
+/*
+ * Copies to and from I/O memory, and memcpy_flushcache(). The I/O side
+ * is accessed naturally aligned, up to 16 bytes at a time, and written
+ * with non-temporal stores: MOVNTI and MOVNTDQ go straight to the write
+ * combining buffers of a framebuffer, and on uncached MMIO they are
+ * plain stores of their width. Only the odd bytes at either end are
+ * stored normally. The callers fence.
+ */
+static __sse2 __always_inline void store_nt(void *d, const void *s,
+					    size_t size)
+{
+	switch (size) {
+	case 1:
+		*(volatile u8 *)d = *(const u8 *)s;
+		break;
+	case 2:
+		*(volatile u16 *)d = *(const u16u *)s;
+		break;
+	case 4:
+		__builtin_ia32_movnti(d, *(const u32u *)s);
+		break;
+	case 8:
+		__builtin_ia32_movnti64(d, *(const u64u *)s);
+		break;
+	case 16:
+		__builtin_ia32_movntdq(d, *(const v16u *)s);
+		break;
+	}
+}
+
+/* With @fill, @s is a 16 byte pattern that is stored over and over */
+static __sse2 __always_inline void write_nt(void *d, const void *s,
+					    size_t n, bool fill)
+{
+	size_t size, step;
+
+	for (size = 1; size < 16; size *= 2) {
+		if (n >= size && ((unsigned long)d & size)) {
+			store_nt(d, s, size);
+			d += size;
+			s += fill ? 0 : size;
+			n -= size;
+		}
+	}
+
+	step = fill ? 0 : 16;
+	for (; n >= 64; n -= 64, d += 64, s += 4 * step) {
+		v16 a = *(const v16u *)s, b = *(const v16u *)(s + step);
+		v16 c = *(const v16u *)(s + 2 * step);
+		v16 e = *(const v16u *)(s + 3 * step);
+
+		__builtin_ia32_movntdq((v16 *)d, a);
+		__builtin_ia32_movntdq((v16 *)d + 1, b);
+		__builtin_ia32_movntdq((v16 *)d + 2, c);
+		__builtin_ia32_movntdq((v16 *)d + 3, e);
+	}
+
+	for (size = 16; size; size /= 2) {
+		for (; n >= size; n -= size, d += size, s += fill ? 0 : size)
+			store_nt(d, s, size);
+	}
+}
+
+static __sse2 __always_inline void load_io(void *d, const void *s,
+					   size_t size)
+{
+	switch (size) {
+	case 1:
+		*(u8 *)d = *(const volatile u8 *)s;
+		break;
+	case 2:
+		*(u16u *)d = *(const volatile u16 *)s;
+		break;
+	case 4:
+		*(u32u *)d = *(const volatile u32 *)s;
+		break;
+	case 8:
+		*(u64u *)d = *(const volatile u64 *)s;
+		break;
+	case 16:
+		*(v16u *)d = *(const volatile v16 *)s;
+		break;
+	}
+}
+
+/**
+ * memcpy_fromio - Copy from I/O memory
+ * @dest: Where to copy to
+ * @src: Where to copy from, in I/O memory
+ * @count: The size of the area.
+ */
+__sse2 void memcpy_fromio(void *dest, const volatile void __iomem *src,
+			  size_t count)
+{
+	const void *s = (const void __force *)src;
+	size_t size;
+
+	for (size = 1; size < 16; size *= 2) {
+		if (count >= size && ((unsigned long)s & size)) {
+			load_io(dest, s, size);
+			dest += size;
+			s += size;
+			count -= size;
+		}
+	}
+	for (size = 16; size; size /= 2) {
+		for (; count >= size; count -= size, dest += size, s += size)
+			load_io(dest, s, size);
+	}
+}
+EXPORT_SYMBOL(memcpy_fromio);
+
+/**
+ * memcpy_toio - Copy to I/O memory
+ * @dest: Where to copy to, in I/O memory
+ * @src: Where to copy from
+ * @count: The size of the area.
+ */
+__sse2 void memcpy_toio(volatile void __iomem *dest, const void *src,
+			size_t count)
+{
+	write_nt((void __force *)dest, src, count, false);
+	__builtin_ia32_sfence();
+}
+EXPORT_SYMBOL(memcpy_toio);
+
+/**
+ * memset_io - Fill I/O memory with the given value
+ * @s: Pointer to the start of the area, in I/O memory
+ * @c: The byte to fill the area with
+ * @count: The size of the area.
+ */
+__sse2 void memset_io(volatile void __iomem *s, int c, size_t count)
+{
+	u64 pattern = (u8)c * 0x0101010101010101ULL;
+	v16 v = (v16){ pattern, pattern };
+
+	write_nt((void __force *)s, &v, count, true);
+	__builtin_ia32_sfence();
+}
+EXPORT_SYMBOL(memset_io);
+
+/**
+ * memcpy_flushcache - Copy to memory, bypassing the caches
+ * @dst: Where to copy to
+ * @src: Where to copy from
+ * @cnt: The size of the area.
+ *
+ * The data is in memory rather than in a cache on return.
+ */
+__sse2 void memcpy_flushcache(void *dst, const void *src, size_t cnt)
+{
+	if (!cnt)
+		return;
+
+	write_nt(dst, src, cnt, false);
+
+	/* The odd bytes at either end went through the cache */
+	if ((unsigned long)dst & 3)
+		__builtin_ia32_clflush(dst);
+	if ((unsigned long)(dst + cnt) & 3)
+		__builtin_ia32_clflush(dst + cnt - 1);
+	__builtin_ia32_sfence();
+}
+EXPORT_SYMBOL(memcpy_flushcache);
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Arena allocator
+ *
+ * Chunks are page runs from kmalloc_large(). The first one also holds
+ * the struct kmem_arena itself, so creating an arena costs one page
+ * allocation. Chunks double in size up to KMEM_ARENA_MAX_CHUNK, requests
+ * bigger than the next chunk get a chunk of their own and leave the
+ * current one in use.
+ */
+
+#include <LinuxBase.h>
+#include <linux/arena.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/export.h>
+#include <linux/bug.h>
+#include <asm/page.h>
+
+#define KMEM_ARENA_MIN_CHUNK	(4 * PAGE_SIZE)
+#define KMEM_ARENA_MAX_CHUNK	(64 * PAGE_SIZE)
+
+static struct kmem_arena_chunk *kmem_arena_new_chunk(size_t size, gfp_t gfp)
+{
+	struct kmem_arena_chunk *chunk;
+
+	chunk = kmalloc_large(size, gfp);
+	if (!chunk)
+		return NULL;
+
+	chunk->size = size;
+	return chunk;
+}
+
+/**
+ * kmem_arena_create - create an arena
+ * @gfp: flags for the allocation of its chunks
+ *
+ * %__GFP_ZERO in @gfp is ignored, use kmem_arena_zalloc() for zeroed
+ * memory.
+ */
+struct kmem_arena *kmem_arena_create(gfp_t gfp)
+{
+	struct kmem_arena_chunk *chunk;
+	struct kmem_arena *arena;
+
+	gfp &= ~__GFP_ZERO;
+	chunk = kmem_arena_new_chunk(KMEM_ARENA_MIN_CHUNK, gfp);
+	if (!chunk)
+		return NULL;
+
+	arena = container_of(chunk, struct kmem_arena, chunk);
+	arena->chunk.next = NULL;
+	arena->chunks = &arena->chunk;
+	arena->gfp = gfp;
+	kmem_arena_reset(arena);
+
+	return arena;
+}
+EXPORT_SYMBOL(kmem_arena_create);
+
+/**
+ * kmem_arena_reset - free everything allocated from an arena
+ * @arena: the arena to reset
+ *
+ * All chunks but the first go back to the page allocator, the arena
+ * itself can be used again right away.
+ */
+void kmem_arena_reset(struct kmem_arena *arena)
+{
+	struct kmem_arena_chunk *chunk, *next;
+
+	for (chunk = arena->chunks; chunk; chunk = next) {
+		next = chunk->next;
+		if (chunk != &arena->chunk)
+			kfree(chunk);
+	}
+
+	arena->chunk.next = NULL;
+	arena->chunks = &arena->chunk;
+	arena->cur = arena + 1;
+	arena->end = (void *)arena + arena->chunk.size;
+	arena->next_size = KMEM_ARENA_MIN_CHUNK * 2;
+}
+EXPORT_SYMBOL(kmem_arena_reset);
+
+/**
+ * kmem_arena_destroy - free an arena and everything allocated from it
+ * @arena: the arena to destroy, may be %NULL
+ */
+void kmem_arena_destroy(struct kmem_arena *arena)
+{
+	if (unlikely(!arena))
+		return;
+
+	kmem_arena_reset(arena);
+	kfree(arena);
+}
+EXPORT_SYMBOL(kmem_arena_destroy);
+
+/* Slow path of kmem_arena_alloc_aligned(), the current chunk is full */
+void *__kmem_arena_alloc(struct kmem_arena *arena, size_t size, size_t align)
+{
+	struct kmem_arena_chunk *chunk;
+	size_t need;
+	void *p;
+
+	if (unlikely(!size))
+		return ZERO_SIZE_PTR;
+
+	if (unlikely(size > SIZE_MAX - sizeof(*chunk) - align))
+		return NULL;
+
+	need = ALIGN(sizeof(*chunk) + align - 1 + size, PAGE_SIZE);
+	if (need > arena->next_size) {
+		/* Too big to share a chunk, keep filling the current one */
+		chunk = kmem_arena_new_chunk(need, arena->gfp);
+		if (!chunk)
+			return NULL;
+
+		chunk->next = arena->chunks->next;
+		arena->chunks->next = chunk;
+		return PTR_ALIGN((void *)(chunk + 1), align);
+	}
+
+	chunk = kmem_arena_new_chunk(arena->next_size, arena->gfp);
+	if (!chunk)
+		return NULL;
+
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	arena->next_size = min_t(size_t, arena->next_size * 2,
+				 KMEM_ARENA_MAX_CHUNK);
+
+	p = PTR_ALIGN((void *)(chunk + 1), align);
+	arena->cur = p + size;
+	arena->end = (void *)chunk + chunk->size;
+	return p;
+}
+EXPORT_SYMBOL(__kmem_arena_alloc);
+
+/**
+ * kmem_arena_zalloc - allocate zeroed memory from an arena
+ * @arena: the arena to allocate from
+ * @size: how many bytes of memory are required
+ */
+void *kmem_arena_zalloc(struct kmem_arena *arena, size_t size)
+{
+	void *p = kmem_arena_alloc(arena, size);
+
+	if (!ZERO_OR_NULL_PTR(p))
+		memset(p, 0, size);
+	return p;
+}
+EXPORT_SYMBOL(kmem_arena_zalloc);
+
+/**
+ * kmem_arena_memdup - duplicate region of memory into an arena
+ * @arena: the arena to allocate from
+ * @src: memory region to duplicate
+ * @len: memory region length
+ */
+void *kmem_arena_memdup(struct kmem_arena *arena, const void *src, size_t len)
+{
+	void *p = kmem_arena_alloc(arena, len);
+
+	if (!ZERO_OR_NULL_PTR(p))
+		memcpy(p, src, len);
+	return p;
+}
+EXPORT_SYMBOL(kmem_arena_memdup);
+
+/**
+ * kmem_arena_strndup - copy at most @max bytes of a string into an arena
+ * @arena: the arena to allocate from
+ * @s: the string to duplicate
+ * @max: read at most @max chars from @s
+ */
+char *kmem_arena_strndup(struct kmem_arena *arena, const char *s, size_t max)
+{
+	size_t len;
+	char *p;
+
+	if (!s)
+		return NULL;
+
+	len = strnlen(s, max);
+	p = kmem_arena_alloc_aligned(arena, len + 1, 1);
+	if (p) {
+		memcpy(p, s, len);
+		p[len] = '\0';
+	}
+	return p;
+}
+EXPORT_SYMBOL(kmem_arena_strndup);
+
+/**
+ * kmem_arena_strdup - copy a string into an arena
+ * @arena: the arena to allocate from
+ * @s: the string to duplicate
+ */
+char *kmem_arena_strdup(struct kmem_arena *arena, const char *s)
+{
+	return kmem_arena_strndup(arena, s, SIZE_MAX);
+}
+EXPORT_SYMBOL(kmem_arena_strdup);
+
+/**
+ * kmem_arena_vasprintf - format a string into an arena
+ * @arena: the arena to allocate from
+ * @fmt: the format string
+ * @args: the arguments for @fmt
+ *
+ * The string is printed straight into the free space of the current
+ * chunk, so unless it does not fit, the format is only processed once.
+ */
+char *kmem_arena_vasprintf(struct kmem_arena *arena, const char *fmt,
+			   va_list args)
+{
+	unsigned int first, second;
+	size_t avail = arena->end - arena->cur;
+	char *p = arena->cur;
+	va_list aq;
+
+	va_copy(aq, args);
+	first = vsnprintf(p, avail, fmt, aq);
+	va_end(aq);
+
+	if (first < avail) {
+		arena->cur = p + first + 1;
+		return p;
+	}
+
+	p = __kmem_arena_alloc(arena, first + 1, 1);
+	if (!p)
+		return NULL;
+
+	second = vsnprintf(p, first + 1, fmt, args);
+	WARN(first != second, "different return values (%u and %u) from vsnprintf(\"%s\", ...)",
+	     first, second, fmt);
+
+	return p;
+}
+EXPORT_SYMBOL(kmem_arena_vasprintf);
+
+char *kmem_arena_asprintf(struct kmem_arena *arena, const char *fmt, ...)
+{
+	va_list ap;
+	char *p;
+
+	va_start(ap, fmt);
+	p = kmem_arena_vasprintf(arena, fmt, ap);
+	va_end(ap);
+
+	return p;
+}
+EXPORT_SYMBOL(kmem_arena_asprintf);
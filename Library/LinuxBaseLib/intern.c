@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * String interning
+ *
+ * Every distinct string is stored once, in an arena that lives as long
+ * as the image, and kstrintern() hands out that copy. Two interned
+ * strings are equal exactly when their pointers are.
+ *
+ * The table is open addressed with linear probing and doubles once it
+ * is three quarters full. It is guarded by raising the TPL to
+ * TPL_NOTIFY: no event notification function runs above that, and the
+ * page allocator may still be called there, so the arena and the table
+ * can grow under the lock.
+ */
+
+#include <LinuxBase.h>
+#include <linux/arena.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/export.h>
+#include <linux/bug.h>
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#define KSTRINTERN_MIN_SLOTS	256
+
+struct kstrintern_slot {
+	const char *str;
+	u32 hash;
+	u32 len;
+};
+
+static struct kmem_arena *kstrintern_arena;
+static struct kstrintern_slot *kstrintern_table;
+static size_t kstrintern_mask;	/* Number of slots minus one */
+static size_t kstrintern_nr;
+
+static EFI_TPL kstrintern_lock(void)
+{
+	EFI_TPL tpl = gBS->RaiseTPL(TPL_HIGH_LEVEL);
+
+	gBS->RestoreTPL(tpl);
+	if (tpl < TPL_NOTIFY)
+		gBS->RaiseTPL(TPL_NOTIFY);
+	return tpl;
+}
+
+static void kstrintern_unlock(EFI_TPL tpl)
+{
+	gBS->RestoreTPL(tpl);
+}
+
+/* FNV-1a */
+static u32 kstrintern_hash(const char *s, size_t len)
+{
+	u32 hash = 0x811c9dc5;
+
+	while (len--) {
+		hash ^= (unsigned char)*s++;
+		hash *= 0x01000193;
+	}
+
+	return hash;
+}
+
+static struct kstrintern_slot *kstrintern_slot(const char *s, size_t len,
+					       u32 hash)
+{
+	struct kstrintern_slot *slot;
+	size_t i;
+
+	for (i = hash & kstrintern_mask;; i = (i + 1) & kstrintern_mask) {
+		slot = &kstrintern_table[i];
+		if (!slot->str)
+			return slot;
+		if (slot->hash == hash && slot->len == len &&
+		    memeq(slot->str, s, len))
+			return slot;
+	}
+}
+
+static bool kstrintern_grow(void)
+{
+	struct kstrintern_slot *old = kstrintern_table, *slot;
+	size_t old_nr = old ? kstrintern_mask + 1 : 0;
+	size_t i, nr = old ? old_nr * 2 : KSTRINTERN_MIN_SLOTS;
+
+	kstrintern_table = kcalloc(nr, sizeof(*slot), GFP_KERNEL);
+	if (!kstrintern_table) {
+		kstrintern_table = old;
+		return false;
+	}
+
+	kstrintern_mask = nr - 1;
+	for (i = 0; i < old_nr; i++) {
+		if (!old[i].str)
+			continue;
+		slot = kstrintern_slot(old[i].str, old[i].len, old[i].hash);
+		*slot = old[i];
+	}
+	kfree(old);
+
+	return true;
+}
+
+/**
+ * kstrintern_len - intern a string of known length
+ * @s: the string, need not be NUL terminated
+ * @len: its length
+ *
+ * Returns the interned copy of @s, NUL terminated, or %NULL if it is not
+ * interned yet and there was no memory to do so. Interned strings are
+ * never freed.
+ */
+const char *kstrintern_len(const char *s, size_t len)
+{
+	struct kstrintern_slot *slot;
+	const char *ret = NULL;
+	char *str;
+	u32 hash;
+	EFI_TPL tpl;
+
+	if (unlikely(!s || len > U32_MAX))
+		return NULL;
+
+	hash = kstrintern_hash(s, len);
+
+	tpl = kstrintern_lock();
+	if (unlikely(!kstrintern_arena)) {
+		kstrintern_arena = kmem_arena_create(GFP_KERNEL);
+		if (!kstrintern_arena)
+			goto out;
+	}
+	if (unlikely(!kstrintern_table ||
+		     kstrintern_nr >= (kstrintern_mask + 1) / 4 * 3)) {
+		if (!kstrintern_grow() && !kstrintern_table)
+			goto out;
+	}
+
+	slot = kstrintern_slot(s, len, hash);
+	if (!slot->str) {
+		/* A table that could not grow still has a free slot */
+		if (kstrintern_nr == kstrintern_mask)
+			goto out;
+
+		str = kmem_arena_alloc_aligned(kstrintern_arena, len + 1, 1);
+		if (!str)
+			goto out;
+		memcpy(str, s, len);
+		str[len] = '\0';
+
+		slot->str = str;
+		slot->hash = hash;
+		slot->len = len;
+		kstrintern_nr++;
+	}
+	ret = slot->str;
+
+out:
+	kstrintern_unlock(tpl);
+	return ret;
+}
+EXPORT_SYMBOL(kstrintern_len);
+
+/**
+ * kstrintern - intern a string
+ * @s: the string
+ *
+ * Returns the one shared copy of @s, see kstrintern_len().
+ */
+const char *kstrintern(const char *s)
+{
+	if (unlikely(!s))
+		return NULL;
+
+	return kstrintern_len(s, strlen(s));
+}
+EXPORT_SYMBOL(kstrintern);
+
+/**
+ * kstrintern_find - look up an interned string
+ * @s: the string
+ *
+ * Like kstrintern(), but returns %NULL instead of interning @s if it is
+ * not interned yet. Use this to compare an arbitrary string against
+ * interned ones without adding to the pool.
+ */
+const char *kstrintern_find(const char *s)
+{
+	struct kstrintern_slot *slot;
+	const char *ret = NULL;
+	size_t len;
+	u32 hash;
+	EFI_TPL tpl;
+
+	if (unlikely(!s))
+		return NULL;
+
+	len = strlen(s);
+	hash = kstrintern_hash(s, len);
+
+	tpl = kstrintern_lock();
+	if (kstrintern_table) {
+		slot = kstrintern_slot(s, len, hash);
+		ret = slot->str;
+	}
+	kstrintern_unlock(tpl);
+
+	return ret;
+}
+EXPORT_SYMBOL(kstrintern_find);
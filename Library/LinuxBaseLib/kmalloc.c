@@ -2,120 +2,1582 @@
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/bug.h>
+#include <linux/cache.h>
+#include <linux/list.h>
+#include <linux/bitmap.h>
+#include <linux/log2.h>
+#include <asm/page.h>
 
 #include <Uefi.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
 
-#define KMEM_HEAD_SIGNATURE   SIGNATURE_32('k','m','e','m')
+#include "slab.h"
+
+/*
+ * A slab is a naturally aligned run of 2^order pages. Objects are carved
+ * from the start of the run, the struct slab describing them lives in the
+ * tail of the run, right behind the per-object profiling records if those
+ * are enabled.
+ */
+#define SLAB_MAX_ORDER		3
+#define SLAB_MIN_OBJECTS	8
+/* Empty slabs kept around per cache before pages go back to the firmware */
+#define SLAB_MIN_PARTIAL	1
+/* Objects bigger than this get whole pages instead of a slab */
+#define SLAB_MAX_SIZE		((PAGE_SIZE << SLAB_MAX_ORDER) / 2)
+/* Caches of objects up to this size share the kmalloc slabs */
+#define SLAB_MERGE_MAX_SIZE	256
+
+/*
+ * GFP_DMA/GFP_DMA32 allocations and SLAB_CACHE_DMA caches get their pages
+ * from an arena below 4GiB, reserved once and handed out by a bitmap.
+ * There is no ISA DMA to cater for, so GFP_DMA means the same.
+ */
+#define KMEM_DMA_ARENA_PAGES	512
+#define KMEM_DMA_MAX_ADDRESS	0xFFFFFFFFULL
+
+/*
+ * Pages GFP_ATOMIC allocations and those above TPL_NOTIFY draw from,
+ * kept as naturally aligned chunks the size of the largest slab.
+ */
+#define KMEM_RESERVE_CHUNKS	16
+#define KMEM_RESERVE_CHUNK_PAGES	(1UL << SLAB_MAX_ORDER)
+
+#define KMEM_PAGE_HASH_BITS	10
+#define KMEM_PAGE_HASH_SIZE	(1UL << KMEM_PAGE_HASH_BITS)
+
+/* Large runs are also hashed by the 2MiB chunk their first page is in */
+#define KMEM_RUN_CHUNK_PAGES	512
+#define KMEM_RUN_HASH_BITS	8
+#define KMEM_RUN_HASH_SIZE	(1UL << KMEM_RUN_HASH_BITS)
 
 struct kmem_cache {
 	unsigned int object_size;/* The original size of the object */
+	unsigned int size;	/* The aligned/padded/added on size  */
 	unsigned int align;	/* Alignment as calculated */
+	unsigned int offset;	/* Free pointer offset */
+	unsigned int order;	/* Page order of a slab */
+	unsigned int objects;	/* Objects per slab, 0 if not slab backed */
 	slab_flags_t flags;	/* Active flags on the slab */
 	const char *name;	/* Slab name for sysfs */
 	void (*ctor)(void *);	/* Called on object slot creation */
+	struct list_head partial;	/* Slabs with free objects */
+	struct list_head full;	/* Slabs without free objects */
+	unsigned long nr_partial;
+	unsigned long nr_large;	/* Live objects of a cache too big for slabs */
+	int refcount;		/* Use counter, merged caches share one */
 };
 
-enum mem_type {
-	MEMTYPE_POOL,
-	MEMTYPE_ALIGNED_PAGES,
+#ifdef CONFIG_KMALLOC_PROFILE
+/*
+ * Allocation profiling. Every object remembers the call site that
+ * allocated it and the size asked for, the sites live in a fixed table
+ * that kmalloc_profile_dump() prints.
+ */
+#define KMEM_PROFILE_SITES_BITS	9
+#define KMEM_PROFILE_SITES	(1 << KMEM_PROFILE_SITES_BITS)
+/* Size histogram buckets: up to 8 bytes, 16, 32, ..., and all above */
+#define KMEM_PROFILE_BUCKETS	18
+
+struct kmem_site {
+	unsigned long caller;
+	unsigned long allocs;
+	unsigned long frees;
+	size_t live;		/* Bytes allocated here and not yet freed */
+	size_t peak;
+	unsigned long hist[KMEM_PROFILE_BUCKETS];
 };
 
-struct mem_head {
-	uint32_t signature;
-	void *base_ptr;
-	size_t base_size;
+struct kmem_track {
+	u32 site;		/* Index into kmem_sites plus one, 0 if free */
+	u32 size;
+};
 
-	gfp_t flags;
-	size_t size;
-	size_t align;
-	enum mem_type type;
-	u8 data[0];
+#define SLAB_TRACK_SIZE		sizeof(struct kmem_track)
+#else
+#define SLAB_TRACK_SIZE		0
+#endif
+
+enum kmem_page_type {
+	KMEM_PAGE_SLAB,
+	KMEM_PAGE_LARGE,
+};
+
+/*
+ * Describes a run of pages owned by the allocator. Runs are hashed by
+ * their first page frame so that kfree() can get from an object back to
+ * its run without a header in front of every object.
+ */
+struct kmem_page {
+	struct hlist_node hash;
+	unsigned long pfn;
+	unsigned long nr_pages;
+	enum kmem_page_type type;
+	bool dma;		/* Must stay below 4GiB */
+#ifdef CONFIG_KMALLOC_PROFILE
+	struct kmem_track track;	/* For large runs */
+#endif
+};
+
+/* A large run, also found by any of its pages through its chunk */
+struct kmem_large {
+	struct kmem_page page;
+	struct hlist_node run;
+};
+
+struct slab {
+	struct kmem_page page;
+	struct list_head list;	/* On the partial or full list of cache */
+	struct kmem_cache *cache;
+	void *freelist;		/* First free object */
+	unsigned int inuse;	/* Objects handed out */
+	unsigned int carved;	/* Objects ever handed out */
+	bool zeroed;		/* Objects past carved are known zero */
+};
+
+static struct hlist_head kmem_page_hash[KMEM_PAGE_HASH_SIZE];
+static struct hlist_head kmem_run_hash[KMEM_RUN_HASH_SIZE];
+static unsigned long kmem_run_max_pages;	/* Longest large run so far */
+
+/* First page frame of the DMA arena, 0 until it is reserved */
+static unsigned long kmem_dma_pfn;
+static unsigned long kmem_dma_map[BITS_TO_LONGS(KMEM_DMA_ARENA_PAGES)];
+
+/* Free reserve chunks, linked through their first word */
+static void *kmem_reserve;
+static unsigned int kmem_reserve_nr;
+
+/* Page runs freed at a TPL where boot services could not take them */
+struct kmem_deferred {
+	struct kmem_deferred *next;
+	unsigned long nr_pages;
+};
+static struct kmem_deferred *kmem_deferred;
+
+#define KMEM_CACHE_INIT(__cache, __name, __size, __flags)		\
+	{								\
+		.object_size = (__size),				\
+		.size = (__size),					\
+		.align = ARCH_KMALLOC_MINALIGN,				\
+		.flags = (__flags),					\
+		.name = (__name),					\
+		.refcount = 1,						\
+		.partial = LIST_HEAD_INIT((__cache).partial),		\
+		.full = LIST_HEAD_INIT((__cache).full),			\
+	}
+
+/* Descriptors of large page runs */
+static struct kmem_cache kmem_page_cache =
+	KMEM_CACHE_INIT(kmem_page_cache, "kmem_page", sizeof(struct kmem_large), 0);
+
+#define KMALLOC_CACHE_INIT(__index, __name, __size)			\
+	[__index] = KMEM_CACHE_INIT(kmalloc_cache_array[__index], __name, \
+				    __size, 0)
+
+#define KMALLOC_DMA_CACHE_INIT(__index, __name, __size)			\
+	[__index] = KMEM_CACHE_INIT(kmalloc_dma_cache_array[__index],	\
+				    __name, __size, SLAB_CACHE_DMA)
+
+static struct kmem_cache kmalloc_cache_array[KMALLOC_SHIFT_HIGH + 1] = {
+	KMALLOC_CACHE_INIT(1, "kmalloc-96", 96),
+	KMALLOC_CACHE_INIT(2, "kmalloc-192", 192),
+	KMALLOC_CACHE_INIT(3, "kmalloc-8", 8),
+	KMALLOC_CACHE_INIT(4, "kmalloc-16", 16),
+	KMALLOC_CACHE_INIT(5, "kmalloc-32", 32),
+	KMALLOC_CACHE_INIT(6, "kmalloc-64", 64),
+	KMALLOC_CACHE_INIT(7, "kmalloc-128", 128),
+	KMALLOC_CACHE_INIT(8, "kmalloc-256", 256),
+	KMALLOC_CACHE_INIT(9, "kmalloc-512", 512),
+	KMALLOC_CACHE_INIT(10, "kmalloc-1024", 1024),
+	KMALLOC_CACHE_INIT(11, "kmalloc-2048", 2048),
+	KMALLOC_CACHE_INIT(12, "kmalloc-4096", 4096),
+	KMALLOC_CACHE_INIT(13, "kmalloc-8192", 8192),
+};
+
+struct kmem_cache *kmalloc_caches[KMALLOC_SHIFT_HIGH + 1] = {
+	[1] = &kmalloc_cache_array[1],
+	[2] = &kmalloc_cache_array[2],
+	[3] = &kmalloc_cache_array[3],
+	[4] = &kmalloc_cache_array[4],
+	[5] = &kmalloc_cache_array[5],
+	[6] = &kmalloc_cache_array[6],
+	[7] = &kmalloc_cache_array[7],
+	[8] = &kmalloc_cache_array[8],
+	[9] = &kmalloc_cache_array[9],
+	[10] = &kmalloc_cache_array[10],
+	[11] = &kmalloc_cache_array[11],
+	[12] = &kmalloc_cache_array[12],
+	[13] = &kmalloc_cache_array[13],
 };
+EXPORT_SYMBOL(kmalloc_caches);
+
+static struct kmem_cache kmalloc_dma_cache_array[KMALLOC_SHIFT_HIGH + 1] = {
+	KMALLOC_DMA_CACHE_INIT(1, "dma-kmalloc-96", 96),
+	KMALLOC_DMA_CACHE_INIT(2, "dma-kmalloc-192", 192),
+	KMALLOC_DMA_CACHE_INIT(3, "dma-kmalloc-8", 8),
+	KMALLOC_DMA_CACHE_INIT(4, "dma-kmalloc-16", 16),
+	KMALLOC_DMA_CACHE_INIT(5, "dma-kmalloc-32", 32),
+	KMALLOC_DMA_CACHE_INIT(6, "dma-kmalloc-64", 64),
+	KMALLOC_DMA_CACHE_INIT(7, "dma-kmalloc-128", 128),
+	KMALLOC_DMA_CACHE_INIT(8, "dma-kmalloc-256", 256),
+	KMALLOC_DMA_CACHE_INIT(9, "dma-kmalloc-512", 512),
+	KMALLOC_DMA_CACHE_INIT(10, "dma-kmalloc-1024", 1024),
+	KMALLOC_DMA_CACHE_INIT(11, "dma-kmalloc-2048", 2048),
+	KMALLOC_DMA_CACHE_INIT(12, "dma-kmalloc-4096", 4096),
+	KMALLOC_DMA_CACHE_INIT(13, "dma-kmalloc-8192", 8192),
+};
+
+static struct kmem_cache *kmalloc_dma_caches[KMALLOC_SHIFT_HIGH + 1] = {
+	[1] = &kmalloc_dma_cache_array[1],
+	[2] = &kmalloc_dma_cache_array[2],
+	[3] = &kmalloc_dma_cache_array[3],
+	[4] = &kmalloc_dma_cache_array[4],
+	[5] = &kmalloc_dma_cache_array[5],
+	[6] = &kmalloc_dma_cache_array[6],
+	[7] = &kmalloc_dma_cache_array[7],
+	[8] = &kmalloc_dma_cache_array[8],
+	[9] = &kmalloc_dma_cache_array[9],
+	[10] = &kmalloc_dma_cache_array[10],
+	[11] = &kmalloc_dma_cache_array[11],
+	[12] = &kmalloc_dma_cache_array[12],
+	[13] = &kmalloc_dma_cache_array[13],
+};
+
+static inline bool gfp_dma(gfp_t flags)
+{
+	return flags & (GFP_DMA | GFP_DMA32);
+}
+
+/*
+ * Conversion table for small slabs sizes / 8 to the index in the
+ * kmalloc array. This is necessary for slabs < 192 since we have non power
+ * of two cache sizes there. The size of larger slabs can be determined using
+ * fls.
+ */
+static u8 size_index[24] = {
+	3,	/* 8 */
+	4,	/* 16 */
+	5,	/* 24 */
+	5,	/* 32 */
+	6,	/* 40 */
+	6,	/* 48 */
+	6,	/* 56 */
+	6,	/* 64 */
+	1,	/* 72 */
+	1,	/* 80 */
+	1,	/* 88 */
+	1,	/* 96 */
+	7,	/* 104 */
+	7,	/* 112 */
+	7,	/* 120 */
+	7,	/* 128 */
+	2,	/* 136 */
+	2,	/* 144 */
+	2,	/* 152 */
+	2,	/* 160 */
+	2,	/* 168 */
+	2,	/* 176 */
+	2,	/* 184 */
+	2	/* 192 */
+};
+
+static inline unsigned int size_index_elem(size_t bytes)
+{
+	return (bytes - 1) / 8;
+}
+
+/*
+ * Find the kmem_cache structure that serves a given size of
+ * allocation
+ */
+static struct kmem_cache *kmalloc_slab(size_t size, gfp_t flags)
+{
+	unsigned int index;
+
+	if (size <= 192) {
+		if (!size)
+			return ZERO_SIZE_PTR;
+
+		index = size_index[size_index_elem(size)];
+	} else
+		index = fls(size - 1);
+
+	if (unlikely(gfp_dma(flags)))
+		return kmalloc_dma_caches[index];
+
+	return kmalloc_caches[index];
+}
+
+/*
+ * Slabs are at least page aligned, so objects of a power of two kmalloc
+ * class are naturally aligned, and kmalloc-96/192 objects are aligned
+ * to 32/64 bytes. Pick the smallest class that gives @align.
+ */
+static struct kmem_cache *kmalloc_slab_align(size_t size, size_t align,
+					     gfp_t flags)
+{
+	struct kmem_cache *c;
+
+	c = kmalloc_slab(max(size, align), flags);
+	if (!ZERO_OR_NULL_PTR(c) && (c->object_size & (align - 1)))
+		c = kmalloc_slab(1U << fls(c->object_size), flags);
+
+	return c;
+}
+
+static void *__kmalloc_large(size_t size, gfp_t flags, size_t align);
+static void *do_kmalloc_large(size_t size, gfp_t flags, unsigned long caller);
+static void __kfree(struct kmem_cache *c, const void *p);
+static bool kmalloc_large_resize(const void *p, size_t new_size, gfp_t flags,
+				 EFI_TPL tpl);
+
+static inline unsigned long kmem_page_hashfn(unsigned long pfn)
+{
+	return ((u32)pfn * 0x61C88647U) >> (32 - KMEM_PAGE_HASH_BITS);
+}
+
+static inline unsigned long kmem_run_hashfn(unsigned long chunk)
+{
+	return ((u32)chunk * 0x61C88647U) >> (32 - KMEM_RUN_HASH_BITS);
+}
+
+static void kmem_page_insert(struct kmem_page *pg)
+{
+	struct kmem_large *l;
+
+	hlist_add_head(&pg->hash, &kmem_page_hash[kmem_page_hashfn(pg->pfn)]);
+
+	if (pg->type == KMEM_PAGE_LARGE) {
+		l = container_of(pg, struct kmem_large, page);
+		hlist_add_head(&l->run, &kmem_run_hash[kmem_run_hashfn(
+				pg->pfn / KMEM_RUN_CHUNK_PAGES)]);
+		kmem_run_max_pages = max(kmem_run_max_pages, pg->nr_pages);
+	}
+}
+
+static void kmem_page_remove(struct kmem_page *pg)
+{
+	hlist_del(&pg->hash);
+
+	if (pg->type == KMEM_PAGE_LARGE)
+		hlist_del(&container_of(pg, struct kmem_large, page)->run);
+}
+
+static struct kmem_page *kmem_page_find(unsigned long pfn)
+{
+	struct kmem_page *pg;
+
+	hlist_for_each_entry(pg, &kmem_page_hash[kmem_page_hashfn(pfn)], hash)
+		if (pg->pfn == pfn)
+			return pg;
+
+	return NULL;
+}
+
+/*
+ * Slabs are naturally aligned, so the run holding @p starts at @p rounded
+ * down to one of the possible slab sizes. Runs never overlap, which makes
+ * the first descriptor found the only candidate.
+ */
+static struct kmem_page *kmem_page_lookup(const void *p)
+{
+	unsigned long pfn = virt_to_pfn(p);
+	struct kmem_page *pg;
+	unsigned int order;
+
+	for (order = 0; order <= SLAB_MAX_ORDER; order++) {
+		pg = kmem_page_find(pfn & ~((1UL << order) - 1));
+		if (pg)
+			return pfn < pg->pfn + pg->nr_pages ? pg : NULL;
+	}
+
+	return NULL;
+}
+
+/*
+ * The large run holding @pfn, wherever in the run it is. The run starts
+ * in the chunk of @pfn or in one of the chunks before it, but no further
+ * back than the longest run there has been.
+ */
+static struct kmem_page *kmem_run_lookup(unsigned long pfn)
+{
+	unsigned long chunk = pfn / KMEM_RUN_CHUNK_PAGES, first = 0;
+	struct kmem_large *l;
+
+	if (pfn >= kmem_run_max_pages)
+		first = (pfn - kmem_run_max_pages + 1) / KMEM_RUN_CHUNK_PAGES;
+
+	for (;; chunk--) {
+		hlist_for_each_entry(l, &kmem_run_hash[kmem_run_hashfn(chunk)],
+				     run)
+			if (pfn >= l->page.pfn &&
+			    pfn < l->page.pfn + l->page.nr_pages)
+				return &l->page;
+		if (chunk == first)
+			return NULL;
+	}
+}
+
+static inline void *slab_address(const struct slab *slab)
+{
+	return pfn_to_virt(slab->page.pfn);
+}
+
+static inline void *get_freepointer(struct kmem_cache *c, void *object)
+{
+	return *(void **)(object + c->offset);
+}
+
+static inline void set_freepointer(struct kmem_cache *c, void *object,
+				   void *fp)
+{
+	*(void **)(object + c->offset) = fp;
+}
+
+static inline unsigned int order_objects(unsigned int order,
+					 unsigned int size)
+{
+	return ((PAGE_SIZE << order) - sizeof(struct slab)) /
+	       (size + SLAB_TRACK_SIZE);
+}
+
+static unsigned int calculate_alignment(slab_flags_t flags,
+		unsigned int align, unsigned int size)
+{
+	/*
+	 * If the user wants hardware cache aligned objects then follow that
+	 * suggestion if the object is sufficiently large.
+	 *
+	 * The hardware cache alignment cannot override the specified
+	 * alignment though. If that is greater then use it.
+	 */
+	if (flags & SLAB_HWCACHE_ALIGN) {
+		unsigned int ralign;
+
+		ralign = cache_line_size();
+		while (size <= ralign / 2)
+			ralign /= 2;
+		align = max(align, ralign);
+	}
+
+	if (align < ARCH_SLAB_MINALIGN)
+		align = ARCH_SLAB_MINALIGN;
+
+	return ALIGN(align, sizeof(void *));
+}
+
+static void calculate_sizes(struct kmem_cache *c)
+{
+	unsigned int size = ALIGN(c->object_size, sizeof(void *));
+	unsigned int order;
+
+	/*
+	 * The free pointer normally overlays the object. Objects set up by a
+	 * constructor must keep their contents while free, so the pointer
+	 * goes behind them.
+	 */
+	c->offset = 0;
+	if (c->ctor) {
+		c->offset = size;
+		size += sizeof(void *);
+	}
+	c->size = ALIGN(size, c->align);
+
+	if (c->size > SLAB_MAX_SIZE) {
+		c->order = 0;
+		c->objects = 0;
+		return;
+	}
+
+	for (order = 0; order < SLAB_MAX_ORDER; order++)
+		if (order_objects(order, c->size) >= SLAB_MIN_OBJECTS)
+			break;
+
+	c->order = order;
+	c->objects = order_objects(order, c->size);
+}
+
+/*
+ * Event notification functions run at raised TPLs and may interrupt an
+ * allocation in progress, so the allocator state is only touched with
+ * the TPL raised to TPL_HIGH_LEVEL. Boot services page calls are not
+ * allowed there and happen outside of the lock.
+ */
+static inline EFI_TPL kmem_lock(void)
+{
+	return gBS->RaiseTPL(TPL_HIGH_LEVEL);
+}
+
+static inline void kmem_unlock(EFI_TPL tpl)
+{
+	gBS->RestoreTPL(tpl);
+}
+
+static inline EFI_TPL kmem_current_tpl(void)
+{
+	EFI_TPL tpl = kmem_lock();
+
+	kmem_unlock(tpl);
+	return tpl;
+}
+
+/*
+ * Above TPL_NOTIFY the firmware must not be asked for pages at all, and
+ * GFP_ATOMIC callers want bounded latency. Both only get pages from the
+ * reserve.
+ */
+static inline bool kmem_atomic(gfp_t flags, EFI_TPL tpl)
+{
+	return (flags & __GFP_ATOMIC) || tpl > TPL_NOTIFY;
+}
+
+#ifdef CONFIG_KMALLOC_PROFILE
+/* The last entry collects the call sites that found the table full */
+static struct kmem_site kmem_sites[KMEM_PROFILE_SITES + 1];
+
+static struct kmem_site *kmem_site_get(unsigned long caller)
+{
+	unsigned int i, n;
+	struct kmem_site *site;
+
+	i = ((u32)caller * 0x61C88647U) >> (32 - KMEM_PROFILE_SITES_BITS);
+	for (n = 0; n < KMEM_PROFILE_SITES; n++) {
+		site = &kmem_sites[(i + n) & (KMEM_PROFILE_SITES - 1)];
+		if (site->caller == caller)
+			return site;
+		if (!site->caller) {
+			site->caller = caller;
+			return site;
+		}
+	}
+
+	return &kmem_sites[KMEM_PROFILE_SITES];
+}
+
+/* Profiling record of the object at @p in the run @pg */
+static struct kmem_track *kmem_object_track(struct kmem_page *pg,
+					    const void *p)
+{
+	struct slab *slab;
+	struct kmem_cache *c;
+
+	if (pg->type == KMEM_PAGE_LARGE)
+		return &pg->track;
+
+	slab = container_of(pg, struct slab, page);
+	c = slab->cache;
+	return (struct kmem_track *)slab - c->objects +
+	       (p - slab_address(slab)) / c->size;
+}
+
+static void kmem_profile_alloc(const void *p, size_t size,
+			       unsigned long caller)
+{
+	struct kmem_track *t;
+	struct kmem_site *site;
+	unsigned int bucket;
+	EFI_TPL tpl;
+
+	if (ZERO_OR_NULL_PTR(p))
+		return;
+
+	bucket = size > 8 ? fls(size - 1) - 3 : 0;
+
+	tpl = kmem_lock();
+	t = kmem_object_track(kmem_page_lookup(p), p);
+	site = kmem_site_get(caller);
+	t->site = site - kmem_sites + 1;
+	t->size = size;
+	site->allocs++;
+	site->live += size;
+	site->peak = max(site->peak, site->live);
+	site->hist[min_t(unsigned int, bucket, KMEM_PROFILE_BUCKETS - 1)]++;
+	kmem_unlock(tpl);
+}
+
+/* Must be called with the lock held */
+static void kmem_profile_free(struct kmem_page *pg, const void *p)
+{
+	struct kmem_track *t = kmem_object_track(pg, p);
+	struct kmem_site *site;
+
+	/* The allocator's own objects are not tracked */
+	if (!t->site)
+		return;
+
+	site = &kmem_sites[t->site - 1];
+	site->frees++;
+	site->live -= t->size;
+	t->site = 0;
+}
+
+static void kmem_profile_resize(const void *p, size_t size)
+{
+	struct kmem_track *t;
+	struct kmem_site *site;
+	EFI_TPL tpl;
+
+	tpl = kmem_lock();
+	t = kmem_object_track(kmem_page_lookup(p), p);
+	if (t->site) {
+		site = &kmem_sites[t->site - 1];
+		site->live += size - t->size;
+		site->peak = max(site->peak, site->live);
+		t->size = size;
+	}
+	kmem_unlock(tpl);
+}
+
+static void kmem_profile_init_slab(struct kmem_cache *c, struct slab *slab)
+{
+	memset((struct kmem_track *)slab - c->objects, 0,
+	       c->objects * sizeof(struct kmem_track));
+}
+
+/**
+ * kmalloc_profile_dump - print allocation statistics per call site
+ *
+ * For every call site that allocated memory, print the number of
+ * allocations and frees, the bytes still allocated, the most bytes
+ * that were allocated at once and a histogram of the sizes asked for.
+ */
+void kmalloc_profile_dump(void)
+{
+	struct kmem_site *site;
+	char buf[KMEM_PROFILE_BUCKETS * 20];
+	size_t live = 0;
+	unsigned int i, b;
+	int len;
+
+	pr_info("kmalloc profile: caller allocs frees live peak\n");
+	for (i = 0; i <= KMEM_PROFILE_SITES; i++) {
+		site = &kmem_sites[i];
+		if (!site->allocs)
+			continue;
+
+		len = 0;
+		buf[0] = '\0';
+		for (b = 0; b < KMEM_PROFILE_BUCKETS; b++) {
+			if (!site->hist[b])
+				continue;
+			if (b == KMEM_PROFILE_BUCKETS - 1)
+				len += scnprintf(buf + len, sizeof(buf) - len,
+						 " >%lu:%lu", 4UL << b,
+						 site->hist[b]);
+			else
+				len += scnprintf(buf + len, sizeof(buf) - len,
+						 " <=%lu:%lu", 8UL << b,
+						 site->hist[b]);
+		}
+
+		if (site->caller)
+			pr_info("  %pS %lu %lu %zu %zu%s\n", (void *)site->caller,
+				site->allocs, site->frees, site->live,
+				site->peak, buf);
+		else
+			pr_info("  <other> %lu %lu %zu %zu%s\n", site->allocs,
+				site->frees, site->live, site->peak, buf);
+		live += site->live;
+	}
+	pr_info("kmalloc profile: %zu bytes live\n", live);
+}
+EXPORT_SYMBOL(kmalloc_profile_dump);
+#else
+static inline void kmem_profile_alloc(const void *p, size_t size,
+				      unsigned long caller) { }
+static inline void kmem_profile_free(struct kmem_page *pg, const void *p) { }
+static inline void kmem_profile_resize(const void *p, size_t size) { }
+static inline void kmem_profile_init_slab(struct kmem_cache *c,
+					  struct slab *slab) { }
+#endif
+
+#ifdef CONFIG_KMALLOC_TRACE
+/*
+ * Allocation tracing. Only the exported entry points record an event,
+ * the allocator calling itself internally does not, so that replaying
+ * a trace issues exactly the calls the firmware made. Once the ring is
+ * full the oldest events are overwritten.
+ */
+#define KMALLOC_TRACE_EVENTS	(1 << 14)
+
+static struct kmalloc_trace_event kmem_trace[KMALLOC_TRACE_EVENTS];
+static u64 kmem_trace_head;
+
+static void kmem_trace_record(enum kmalloc_trace_op op, const void *ptr,
+			      const void *old, size_t size, size_t align,
+			      gfp_t flags)
+{
+	struct kmalloc_trace_event *e;
+	u64 now = GetPerformanceCounter();
+	EFI_TPL tpl;
+
+	tpl = kmem_lock();
+	e = &kmem_trace[kmem_trace_head++ & (KMALLOC_TRACE_EVENTS - 1)];
+	e->timestamp = now;
+	e->op = op;
+	e->align_order = align ? ilog2(align) : 0;
+	e->ptr = (unsigned long)ptr;
+	e->old = (unsigned long)old;
+	e->size = min_t(size_t, size, U32_MAX);
+	e->gfp = (__force u32)flags;
+	kmem_unlock(tpl);
+}
+
+/**
+ * kmalloc_trace_count - number of events recorded so far
+ *
+ * This includes the events that were overwritten since, the ring holds
+ * the last KMALLOC_TRACE_EVENTS of them.
+ */
+u64 kmalloc_trace_count(void)
+{
+	return READ_ONCE(kmem_trace_head);
+}
+EXPORT_SYMBOL(kmalloc_trace_count);
+
+/**
+ * kmalloc_trace_snapshot - copy the recorded events out of the ring
+ * @buf: where to store the events
+ * @nr: how many events fit into @buf
+ *
+ * Copies up to @nr of the most recent events into @buf, oldest first.
+ * Returns the number of events copied.
+ */
+size_t kmalloc_trace_snapshot(struct kmalloc_trace_event *buf, size_t nr)
+{
+	u64 head, first;
+	size_t i;
+	EFI_TPL tpl;
+
+	tpl = kmem_lock();
+	head = kmem_trace_head;
+	nr = min_t(u64, nr, min_t(u64, head, KMALLOC_TRACE_EVENTS));
+	first = head - nr;
+	for (i = 0; i < nr; i++)
+		buf[i] = kmem_trace[(first + i) & (KMALLOC_TRACE_EVENTS - 1)];
+	kmem_unlock(tpl);
+
+	return nr;
+}
+EXPORT_SYMBOL(kmalloc_trace_snapshot);
+#else
+static inline void kmem_trace_record(enum kmalloc_trace_op op,
+				     const void *ptr, const void *old,
+				     size_t size, size_t align,
+				     gfp_t flags) { }
+#endif
+
+/*
+ * Drop the page runs freed at raised TPL and top the reserve up again.
+ * Only called at TPL_APPLICATION, where nothing else is in the middle of
+ * an allocation.
+ */
+static void kmem_refill(void)
+{
+	struct kmem_deferred *d, *next;
+	void *chunk;
+	EFI_TPL tpl;
+
+	tpl = kmem_lock();
+	d = kmem_deferred;
+	kmem_deferred = NULL;
+	kmem_unlock(tpl);
+
+	for (; d; d = next) {
+		next = d->next;
+		FreePages(d, d->nr_pages);
+	}
+
+	while (kmem_reserve_nr < KMEM_RESERVE_CHUNKS) {
+		chunk = AllocateAlignedPages(KMEM_RESERVE_CHUNK_PAGES,
+					     KMEM_RESERVE_CHUNK_PAGES << PAGE_SHIFT);
+		if (!chunk)
+			break;
+
+		tpl = kmem_lock();
+		*(void **)chunk = kmem_reserve;
+		kmem_reserve = chunk;
+		kmem_reserve_nr++;
+		kmem_unlock(tpl);
+	}
+}
+
+static inline void kmem_maybe_refill(EFI_TPL tpl)
+{
+	if (unlikely(kmem_reserve_nr < KMEM_RESERVE_CHUNKS || kmem_deferred) &&
+	    tpl == TPL_APPLICATION)
+		kmem_refill();
+}
+
+/*
+ * Take a chunk from the reserve for @nr_pages aligned to @align. The whole
+ * chunk goes to the caller, @nr_pages is updated to match.
+ */
+static void *kmem_reserve_get(unsigned long *nr_pages, size_t align)
+{
+	void *chunk;
+	EFI_TPL tpl;
+
+	if (*nr_pages > KMEM_RESERVE_CHUNK_PAGES ||
+	    align > (KMEM_RESERVE_CHUNK_PAGES << PAGE_SHIFT))
+		return NULL;
+
+	tpl = kmem_lock();
+	chunk = kmem_reserve;
+	if (chunk) {
+		kmem_reserve = *(void **)chunk;
+		kmem_reserve_nr--;
+	}
+	kmem_unlock(tpl);
+
+	if (chunk)
+		*nr_pages = KMEM_RESERVE_CHUNK_PAGES;
+	return chunk;
+}
+
+static inline bool kmem_dma_contains(unsigned long pfn)
+{
+	return kmem_dma_pfn && pfn >= kmem_dma_pfn &&
+	       pfn < kmem_dma_pfn + KMEM_DMA_ARENA_PAGES;
+}
+
+/*
+ * Ask the firmware for @nr_pages pages aligned to @align below 4GiB.
+ * AllocateMaxAddress has no alignment, so over-allocate and trim.
+ */
+static void *kmem_alloc_low_pages(unsigned long nr_pages, size_t align)
+{
+	unsigned long slack = align > PAGE_SIZE ? (align >> PAGE_SHIFT) - 1 : 0;
+	EFI_PHYSICAL_ADDRESS addr = KMEM_DMA_MAX_ADDRESS;
+	EFI_PHYSICAL_ADDRESS start;
+	unsigned long head;
+	EFI_STATUS status;
+
+	status = gBS->AllocatePages(AllocateMaxAddress, EfiBootServicesData,
+				    nr_pages + slack, &addr);
+	if (EFI_ERROR(status))
+		return NULL;
+
+	start = ALIGN(addr, max_t(size_t, align, PAGE_SIZE));
+	head = (start - addr) >> PAGE_SHIFT;
+	if (head)
+		gBS->FreePages(addr, head);
+	if (slack - head)
+		gBS->FreePages(start + (nr_pages << PAGE_SHIFT), slack - head);
+
+	return (void *)(uintptr_t)start;
+}
+
+static bool kmem_dma_init(void)
+{
+	static bool failed;
+	void *base;
+
+	if (kmem_dma_pfn)
+		return true;
+	if (failed)
+		return false;
+
+	base = kmem_alloc_low_pages(KMEM_DMA_ARENA_PAGES, PAGE_SIZE);
+	if (!base) {
+		pr_warn("kmalloc: no DMA arena below 4GiB\n");
+		failed = true;
+		return false;
+	}
+
+	kmem_dma_pfn = virt_to_pfn(base);
+	return true;
+}
+
+static void *kmem_alloc_dma_pages(unsigned long nr_pages, size_t align,
+				  bool atomic)
+{
+	unsigned long mask = align > PAGE_SIZE ? (align >> PAGE_SHIFT) - 1 : 0;
+	unsigned long index;
+	EFI_TPL tpl;
+
+	if (atomic ? kmem_dma_pfn : kmem_dma_init()) {
+		tpl = kmem_lock();
+		index = bitmap_find_next_zero_area_off(kmem_dma_map,
+						       KMEM_DMA_ARENA_PAGES,
+						       0, nr_pages, mask,
+						       kmem_dma_pfn & mask);
+		if (index < KMEM_DMA_ARENA_PAGES)
+			bitmap_set(kmem_dma_map, index, nr_pages);
+		kmem_unlock(tpl);
+
+		if (index < KMEM_DMA_ARENA_PAGES)
+			return pfn_to_virt(kmem_dma_pfn + index);
+	}
+
+	if (atomic)
+		return NULL;
+
+	/* The arena is exhausted, fall back to a constrained allocation */
+	return kmem_alloc_low_pages(nr_pages, align);
+}
+
+/*
+ * Backing pages for slabs and large runs, aligned to @align. With @dma
+ * the pages sit below 4GiB. An @atomic caller may get more pages than it
+ * asked for, @nr_pages tells how many.
+ */
+static void *kmem_alloc_pages(unsigned long *nr_pages, size_t align,
+			      bool dma, bool atomic)
+{
+	if (unlikely(dma))
+		return kmem_alloc_dma_pages(*nr_pages, align, atomic);
+	if (unlikely(atomic))
+		return kmem_reserve_get(nr_pages, align);
+	if (align > PAGE_SIZE)
+		return AllocateAlignedPages(*nr_pages, align);
+	return AllocatePages(*nr_pages);
+}
+
+/*
+ * Give pages back. Runs freed above TPL_NOTIFY are parked until
+ * kmem_refill() can hand them to the firmware.
+ */
+static void kmem_free_pages(void *base, unsigned long nr_pages, EFI_TPL tpl)
+{
+	unsigned long pfn = virt_to_pfn(base);
+	struct kmem_deferred *d;
+
+	if (kmem_dma_contains(pfn)) {
+		tpl = kmem_lock();
+		bitmap_clear(kmem_dma_map, pfn - kmem_dma_pfn, nr_pages);
+		kmem_unlock(tpl);
+	} else if (tpl > TPL_NOTIFY) {
+		d = base;
+		d->nr_pages = nr_pages;
+		tpl = kmem_lock();
+		d->next = kmem_deferred;
+		kmem_deferred = d;
+		kmem_unlock(tpl);
+	} else {
+		FreePages(base, nr_pages);
+	}
+}
+
+/*
+ * Extend the run at @pfn by @nr_pages in place. Pages after a DMA run
+ * also have to stay below 4GiB.
+ */
+static bool kmem_grow_pages(unsigned long pfn, unsigned long nr_pages,
+			    unsigned long extra, bool dma)
+{
+	EFI_PHYSICAL_ADDRESS addr = (EFI_PHYSICAL_ADDRESS)(pfn + nr_pages)
+				    << PAGE_SHIFT;
+	unsigned long index;
+	EFI_STATUS status;
+	EFI_TPL tpl;
+	bool ret;
+
+	if (kmem_dma_contains(pfn)) {
+		index = pfn + nr_pages - kmem_dma_pfn;
+		if (index + extra > KMEM_DMA_ARENA_PAGES)
+			return false;
+
+		tpl = kmem_lock();
+		ret = find_next_bit(kmem_dma_map, index + extra, index) >=
+		      index + extra;
+		if (ret)
+			bitmap_set(kmem_dma_map, index, extra);
+		kmem_unlock(tpl);
+
+		return ret;
+	}
+
+	if (dma && addr + (extra << PAGE_SHIFT) - 1 > KMEM_DMA_MAX_ADDRESS)
+		return false;
+
+	status = gBS->AllocatePages(AllocateAddress, EfiBootServicesData,
+				    extra, &addr);
+	return !EFI_ERROR(status);
+}
+
+static struct slab *init_slab(struct kmem_cache *c, gfp_t flags, void *base)
+{
+	struct slab *slab;
+	unsigned int i;
+
+	slab = base + (PAGE_SIZE << c->order) - sizeof(*slab);
+	slab->page.pfn = virt_to_pfn(base);
+	slab->page.nr_pages = 1UL << c->order;
+	slab->page.type = KMEM_PAGE_SLAB;
+	slab->page.dma = c->flags & SLAB_CACHE_DMA;
+	slab->cache = c;
+	slab->freelist = NULL;
+	slab->inuse = 0;
+	slab->carved = 0;
+	slab->zeroed = false;
+	kmem_profile_init_slab(c, slab);
+
+	/*
+	 * A zeroing request clears the whole slab at once, so the objects
+	 * carved from it later need no memset of their own. With a
+	 * constructor the objects are never zero to begin with.
+	 */
+	if (c->ctor) {
+		for (i = 0; i < c->objects; i++)
+			c->ctor(base + i * c->size);
+	} else if (flags & __GFP_ZERO) {
+		memset(base, 0, c->objects * c->size);
+		slab->zeroed = true;
+	}
+
+	return slab;
+}
+
+/*
+ * Grow @c by @nr slabs. They come from a single page allocation, each
+ * slab is still naturally aligned and is later freed on its own. The
+ * slabs are set up before they are published, outside of the lock.
+ */
+static bool new_slabs(struct kmem_cache *c, gfp_t flags, unsigned int nr,
+		      EFI_TPL tpl)
+{
+	unsigned long nr_pages;
+	struct slab *slab;
+	void *base;
+	unsigned int i;
+	bool atomic;
+
+	/* The static caches get their layout on first use */
+	if (unlikely(!c->objects))
+		calculate_sizes(c);
+
+	atomic = kmem_atomic(flags, tpl);
+	if (atomic)
+		nr = min_t(unsigned int, nr,
+			   KMEM_RESERVE_CHUNK_PAGES >> c->order);
+
+	nr_pages = (unsigned long)nr << c->order;
+	base = kmem_alloc_pages(&nr_pages, PAGE_SIZE << c->order,
+				c->flags & SLAB_CACHE_DMA, atomic);
+	if (!base)
+		return false;
+
+	nr = nr_pages >> c->order;
+	for (i = 0; i < nr; i++)
+		init_slab(c, flags, base + (i * PAGE_SIZE << c->order));
+
+	tpl = kmem_lock();
+	for (i = 0; i < nr; i++) {
+		slab = base + ((i + 1) * PAGE_SIZE << c->order) - sizeof(*slab);
+		kmem_page_insert(&slab->page);
+		list_add(&slab->list, &c->partial);
+		c->nr_partial++;
+	}
+	kmem_unlock(tpl);
+
+	return true;
+}
+
+static void discard_slab(struct slab *slab, EFI_TPL tpl)
+{
+	kmem_free_pages(slab_address(slab), slab->page.nr_pages, tpl);
+}
+
+static void *slab_alloc(struct kmem_cache *c, gfp_t flags)
+{
+	struct slab *slab;
+	void *object;
+	bool zeroed;
+	EFI_TPL tpl;
+
+	tpl = kmem_lock();
+	while (unlikely(!(slab = list_first_entry_or_null(&c->partial,
+							  struct slab, list)))) {
+		kmem_unlock(tpl);
+		if (!new_slabs(c, flags, 1, tpl))
+			return NULL;
+		kmem_lock();
+	}
+
+	object = slab->freelist;
+	if (object) {
+		slab->freelist = get_freepointer(c, object);
+		zeroed = false;
+	} else {
+		object = slab_address(slab) + slab->carved++ * c->size;
+		zeroed = slab->zeroed;
+	}
+
+	if (++slab->inuse == c->objects) {
+		list_move(&slab->list, &c->full);
+		c->nr_partial--;
+	}
+	kmem_unlock(tpl);
+
+	if (unlikely(flags & __GFP_ZERO) && !zeroed)
+		memset(object, 0, c->object_size);
 
-static void *__do_alloc(size_t size, gfp_t flags, size_t align);
+	kmem_maybe_refill(tpl);
+
+	return object;
+}
+
+/*
+ * Give @cnt objects, chained from @head to @tail through their free
+ * pointers, back to @slab in one go. Must be called with the lock held.
+ * Returns @slab if it became empty and was unhashed; the caller hands
+ * its pages back once the lock is dropped.
+ */
+static struct slab *slab_free_list(struct kmem_cache *c, struct slab *slab,
+				   void *head, void *tail, unsigned int cnt)
+{
+	set_freepointer(c, tail, slab->freelist);
+	slab->freelist = head;
+
+	if (slab->inuse == c->objects) {
+		list_move(&slab->list, &c->partial);
+		c->nr_partial++;
+	}
+	slab->inuse -= cnt;
+
+	if (!slab->inuse && c->nr_partial > SLAB_MIN_PARTIAL) {
+		list_del(&slab->list);
+		c->nr_partial--;
+		kmem_page_remove(&slab->page);
+		return slab;
+	}
+
+	return NULL;
+}
 
 struct kmem_cache *kmem_cache_create(const char *name, size_t size,
 			size_t align, slab_flags_t flags,
 			void (*ctor)(void *))
 {
 	struct kmem_cache *c;
+	EFI_TPL tpl;
+
+	align = calculate_alignment(flags, align, size);
+
+	/*
+	 * Small caches without a constructor share the kmalloc slabs of a
+	 * class with the right alignment, so a handful of objects does not
+	 * pin a slab of their own.
+	 */
+	if (!ctor && ALIGN(size, align) <= SLAB_MERGE_MAX_SIZE) {
+		c = kmalloc_slab_align(ALIGN(size, align), align,
+				       flags & SLAB_CACHE_DMA ? GFP_DMA32 : 0);
+		if (!ZERO_OR_NULL_PTR(c)) {
+			tpl = kmem_lock();
+			c->refcount++;
+			kmem_unlock(tpl);
+			return c;
+		}
+	}
 
 	c = kmalloc(sizeof(*c), GFP_KERNEL);
-	if (!c)
+	if (c) {
+		c->name = kstrdup_const(name, GFP_KERNEL);
+		if (!c->name) {
+			kfree(c);
+			c = NULL;
+		}
+	}
+	if (!c) {
+		if (flags & SLAB_PANIC)
+			panic("kmem_cache_create: Failed to create slab '%s'\n",
+			      name);
 		return NULL;
+	}
 
 	c->object_size = size;
 	c->align = align;
 	c->flags = flags;
-	c->name = name;
 	c->ctor = ctor;
+	INIT_LIST_HEAD(&c->partial);
+	INIT_LIST_HEAD(&c->full);
+	c->nr_partial = 0;
+	c->nr_large = 0;
+	c->refcount = 1;
+	calculate_sizes(c);
 
 	return c;
 }
 
 void kmem_cache_destroy(struct kmem_cache *c) {
+	struct slab *slab, *t;
+	bool busy;
+	EFI_TPL tpl;
+
 	if (unlikely(!c))
 		return;
 
+	tpl = kmem_lock();
+	if (--c->refcount) {
+		kmem_unlock(tpl);
+		return;
+	}
+
+	busy = !list_empty(&c->full) || c->nr_large;
+	list_for_each_entry(slab, &c->partial, list)
+		busy |= slab->inuse != 0;
+
+	if (!busy)
+		list_for_each_entry(slab, &c->partial, list)
+			kmem_page_remove(&slab->page);
+	kmem_unlock(tpl);
+
+	if (busy) {
+		pr_err("kmem_cache_destroy %s: Slab cache still has objects\n",
+		       c->name);
+		return;
+	}
+
+	list_for_each_entry_safe(slab, t, &c->partial, list)
+		discard_slab(slab, tpl);
+
+	kfree_const(c->name);
 	kfree(c);
 }
 
-void *kmem_cache_alloc(struct kmem_cache *c, gfp_t flags) {
+/*
+ * Objects of a cache too big for slabs are page runs of their own, the
+ * cache only counts them so that kmem_cache_destroy() sees they are live.
+ */
+static void kmem_cache_large_count(struct kmem_cache *c, long nr)
+{
+	EFI_TPL tpl;
+
+	tpl = kmem_lock();
+	c->nr_large += nr;
+	kmem_unlock(tpl);
+}
+
+static void *__kmem_cache_alloc(struct kmem_cache *c, gfp_t flags)
+{
 	void *b;
 
-	b = __do_alloc(c->object_size, flags, c->align);
-	b = kmalloc(c->object_size, flags);
+	if (likely(c->size <= SLAB_MAX_SIZE))
+		return slab_alloc(c, flags);
+
+	if (c->flags & SLAB_CACHE_DMA)
+		flags |= GFP_DMA32;
+	b = __kmalloc_large(c->object_size, flags, c->align);
+	if (!b)
+		return NULL;
 
-	if (b && c->ctor)
+	kmem_cache_large_count(c, 1);
+	if (c->ctor)
 		c->ctor(b);
 
 	return b;
 }
 
+void *kmem_cache_alloc(struct kmem_cache *c, gfp_t flags) {
+	void *b = __kmem_cache_alloc(c, flags);
+
+	kmem_profile_alloc(b, c->object_size, _RET_IP_);
+	kmem_trace_record(KMALLOC_TRACE_CACHE_ALLOC, b, NULL, c->object_size,
+			  c->align, flags);
+	return b;
+}
+
+static void kfree_large(struct kmem_page *pg, EFI_TPL tpl)
+{
+	kmem_free_pages(pfn_to_virt(pg->pfn), pg->nr_pages, tpl);
+	__kfree(&kmem_page_cache, pg);
+}
+
+/* Free @p, checking that it came from @c unless that is NULL */
+static void __kfree(struct kmem_cache *c, const void *p)
+{
+	struct kmem_page *pg;
+	struct slab *slab;
+	bool mismatch;
+	EFI_TPL tpl;
+
+	tpl = kmem_lock();
+	pg = kmem_page_lookup(p);
+	BUG_ON(!pg);
+	kmem_profile_free(pg, p);
+
+	if (pg->type == KMEM_PAGE_LARGE) {
+		kmem_page_remove(pg);
+		kmem_unlock(tpl);
+		kfree_large(pg, tpl);
+		return;
+	}
+
+	slab = container_of(pg, struct slab, page);
+	mismatch = c && slab->cache != c;
+	slab = slab_free_list(slab->cache, slab, (void *)p, (void *)p, 1);
+	kmem_unlock(tpl);
+
+	WARN_ON(mismatch);
+	if (slab)
+		discard_slab(slab, tpl);
+}
+
 void kmem_cache_free(struct kmem_cache *c, void *p) {
-	kfree(p);
+	kmem_trace_record(KMALLOC_TRACE_CACHE_FREE, p, NULL, c->object_size,
+			  c->align, 0);
+	if (c->size <= SLAB_MAX_SIZE) {
+		__kfree(c, p);
+		return;
+	}
+
+	if (unlikely(ZERO_OR_NULL_PTR(p)))
+		return;
+	__kfree(NULL, p);
+	kmem_cache_large_count(c, -1);
 }
 
-void kmem_cache_free_bulk(struct kmem_cache *c, size_t nr, void **p)
+static inline bool slab_contains(struct slab *slab, const void *p)
+{
+	void *base = slab_address(slab);
+
+	return p >= base && p < base + (slab->page.nr_pages << PAGE_SHIFT);
+}
+
+/*
+ * Chain p[i] and the following objects that live in the same slab into
+ * a detached freelist, clearing their slots in @p. Like SLUB, give up
+ * after a few objects from other slabs so that a scattered array does
+ * not turn this quadratic.
+ */
+static size_t build_detached_freelist(struct kmem_cache *c, struct slab *slab,
+				      size_t nr, void **p, void **tail)
 {
+	void *head = p[0];
+	size_t cnt = 1;
 	size_t i;
+	int lookahead = 3;
+
+	*tail = head;
+	p[0] = NULL;
+
+	for (i = 1; i < nr; i++) {
+		void *object = p[i];
+
+		if (!object)
+			continue;
+
+		if (!slab_contains(slab, object)) {
+			if (!--lookahead)
+				break;
+			continue;
+		}
+
+		kmem_profile_free(&slab->page, object);
+		set_freepointer(c, object, head);
+		head = object;
+		p[i] = NULL;
+		cnt++;
+	}
+
+	/* The head of the chain was moved to the front */
+	p[0] = head;
+	return cnt;
+}
+
+static void __kmem_cache_free_bulk(size_t nr, void **p)
+{
+	struct kmem_page *pg;
+	struct slab *slab;
+	void *tail;
+	size_t i, cnt;
+	EFI_TPL tpl;
 
 	for (i = 0; i < nr; i++) {
+		if (unlikely(ZERO_OR_NULL_PTR(p[i])))
+			continue;
+
+		tpl = kmem_lock();
+		pg = kmem_page_lookup(p[i]);
+		BUG_ON(!pg);
+		kmem_profile_free(pg, p[i]);
+
+		if (pg->type == KMEM_PAGE_LARGE) {
+			kmem_page_remove(pg);
+			kmem_unlock(tpl);
+			kfree_large(pg, tpl);
+			continue;
+		}
+
+		slab = container_of(pg, struct slab, page);
+		cnt = build_detached_freelist(slab->cache, slab, nr - i, p + i,
+					      &tail);
+		slab = slab_free_list(slab->cache, slab, p[i], tail, cnt);
+		kmem_unlock(tpl);
+
+		if (slab)
+			discard_slab(slab, tpl);
+	}
+}
+
+/*
+ * Note that, as in Linux, the array is used as scratch space and its
+ * contents are undefined on return.
+ */
+void kmem_cache_free_bulk(struct kmem_cache *c, size_t nr, void **p)
+{
+	size_t i, live = 0;
+
+	if (c && c->size > SLAB_MAX_SIZE)
+		for (i = 0; i < nr; i++)
+			live += !ZERO_OR_NULL_PTR(p[i]);
+
+#ifdef CONFIG_KMALLOC_TRACE
+	for (i = 0; i < nr; i++) {
+		if (ZERO_OR_NULL_PTR(p[i]))
+			continue;
 		if (c)
-			kmem_cache_free(c, p[i]);
+			kmem_trace_record(KMALLOC_TRACE_CACHE_FREE, p[i], NULL,
+					  c->object_size, c->align, 0);
 		else
-			kfree(p[i]);
+			kmem_trace_record(KMALLOC_TRACE_FREE, p[i], NULL, 0,
+					  0, 0);
 	}
+#endif
+
+	__kmem_cache_free_bulk(nr, p);
+	if (live)
+		kmem_cache_large_count(c, -(long)live);
 }
 EXPORT_SYMBOL(kmem_cache_free_bulk);
 
+/* Upper bound on the slabs kmem_cache_alloc_bulk() adds in one go */
+#define SLAB_BULK_MAX_SLABS	64
+
+/*
+ * Fill @p from the partial slabs first, draining each slab's freelist
+ * and then its uncarved tail before moving on. Once they run out, grow
+ * the cache by as many slabs as the rest of the request needs with a
+ * single page allocation. Returns @nr, or 0 with nothing allocated.
+ */
 int kmem_cache_alloc_bulk(struct kmem_cache *c, gfp_t flags, size_t nr,
 								void **p)
 {
-	size_t i;
+	struct slab *slab;
+	void *object;
+	size_t i = 0;
+	EFI_TPL tpl;
 
-	for (i = 0; i < nr; i++) {
-		void *x = p[i] = kmem_cache_alloc(c, flags);
-		if (!x) {
-			kmem_cache_free_bulk(c, i, p);
-			return 0;
+	if (unlikely(c->size > SLAB_MAX_SIZE)) {
+		for (i = 0; i < nr; i++) {
+			p[i] = __kmem_cache_alloc(c, flags);
+			if (!p[i])
+				goto error;
+		}
+		goto out;
+	}
+
+	if (unlikely(!c->objects))
+		calculate_sizes(c);
+
+	tpl = kmem_lock();
+	while (i < nr) {
+		slab = list_first_entry_or_null(&c->partial, struct slab, list);
+		if (!slab) {
+			kmem_unlock(tpl);
+			if (!new_slabs(c, flags,
+				       min_t(size_t, SLAB_BULK_MAX_SLABS,
+					     DIV_ROUND_UP(nr - i, c->objects)),
+				       tpl))
+				goto error;
+			kmem_lock();
+			continue;
+		}
+
+		while (i < nr && (object = slab->freelist)) {
+			slab->freelist = get_freepointer(c, object);
+			slab->inuse++;
+			if (unlikely(flags & __GFP_ZERO))
+				memset(object, 0, c->object_size);
+			p[i++] = object;
+		}
+
+		object = slab_address(slab) + slab->carved * c->size;
+		while (i < nr && slab->carved < c->objects) {
+			slab->carved++;
+			slab->inuse++;
+			if (unlikely(flags & __GFP_ZERO) && !slab->zeroed)
+				memset(object, 0, c->object_size);
+			p[i++] = object;
+			object += c->size;
+		}
+
+		if (slab->inuse == c->objects) {
+			list_move(&slab->list, &c->full);
+			c->nr_partial--;
 		}
 	}
-	return i;
+	kmem_unlock(tpl);
+
+	kmem_maybe_refill(tpl);
+
+out:
+	for (i = 0; i < nr; i++) {
+		kmem_profile_alloc(p[i], c->object_size, _RET_IP_);
+		kmem_trace_record(KMALLOC_TRACE_CACHE_ALLOC, p[i], NULL,
+				  c->object_size, c->align, flags);
+	}
+
+	return nr;
+
+error:
+	__kmem_cache_free_bulk(i, p);
+	if (c->size > SLAB_MAX_SIZE && i)
+		kmem_cache_large_count(c, -(long)i);
+	return 0;
 }
 EXPORT_SYMBOL(kmem_cache_alloc_bulk);
 
+static __always_inline void *do_kmalloc(size_t size, gfp_t flags,
+					unsigned long caller)
+{
+	struct kmem_cache *c;
+	void *ret;
+
+	if (unlikely(size > KMALLOC_MAX_CACHE_SIZE))
+		return do_kmalloc_large(size, flags, caller);
+
+	c = kmalloc_slab(size, flags);
+	if (unlikely(ZERO_OR_NULL_PTR(c)))
+		return c;
+
+	ret = slab_alloc(c, flags);
+	kmem_profile_alloc(ret, size, caller);
+	return ret;
+}
+
 static __always_inline void *__do_krealloc(const void *p, size_t new_size,
 					   gfp_t flags)
 {
 	void *ret;
 	size_t ks = 0;
+	EFI_TPL tpl;
+
+	/*
+	 * Size classes leave slack behind most objects, and page runs can
+	 * often grow into the pages behind them. Either way the data stays
+	 * where it is, which keeps callers growing a buffer step by step
+	 * from copying it over and over.
+	 */
+	if (p) {
+		tpl = kmem_current_tpl();
+		if (!kmem_atomic(flags, tpl) &&
+		    kmalloc_large_resize(p, new_size, flags, tpl)) {
+			kmem_profile_resize(p, new_size);
+			return (void *)p;
+		}
 
-	if (p)
 		ks = ksize(p);
+		if (ks >= new_size) {
+			kmem_profile_resize(p, new_size);
+			return (void *)p;
+		}
+	}
 
-	ret = kmalloc_track_caller(new_size, flags);
+	ret = do_kmalloc(new_size, flags, _RET_IP_);
 	if (ret && p)
 		memcpy(ret, p, ks);
 
@@ -127,14 +1589,16 @@ void *krealloc(const void *p, size_t new_size, gfp_t flags)
 	void *ret;
 
 	if (unlikely(!new_size)) {
-		kfree(p);
-		return ZERO_SIZE_PTR;
+		ret = ZERO_SIZE_PTR;
+		if (!ZERO_OR_NULL_PTR(p))
+			__kfree(NULL, p);
+	} else {
+		ret = __do_krealloc(p, new_size, flags);
+		if (ret && p != ret && !ZERO_OR_NULL_PTR(p))
+			__kfree(NULL, p);
 	}
 
-	ret = __do_krealloc(p, new_size, flags);
-	if (ret && p != ret)
-		kfree(p);
-
+	kmem_trace_record(KMALLOC_TRACE_REALLOC, ret, p, new_size, 0, flags);
 	return ret;
 }
 EXPORT_SYMBOL(krealloc);
@@ -152,102 +1616,187 @@ void kzfree(const void *p)
 }
 EXPORT_SYMBOL(kzfree);
 
-void *__kmalloc_track_caller(size_t size, gfp_t flags, unsigned long caller) {
-	return kmalloc(size, flags);
-}
 
-static void *__do_alloc(size_t size, gfp_t flags, size_t align)
+/*
+ * Requests too big for the kmalloc caches get a run of pages of their
+ * own. The descriptor lives in a side table, so the payload starts right
+ * at the first page.
+ */
+static void *__kmalloc_large(size_t size, gfp_t flags, size_t align)
 {
-	void *base_mem;
-	struct mem_head *head;
-	size_t head_size;
-	size_t base_size;
-	enum mem_type type;
+	struct kmem_page *pg;
+	unsigned long nr_pages;
+	void *base;
+	EFI_TPL tpl;
+
+	pg = slab_alloc(&kmem_page_cache, flags & ~__GFP_ZERO);
+	if (!pg)
+		return NULL;
 
-	if (size == 0) {
-		return ZERO_SIZE_PTR;
+	tpl = kmem_current_tpl();
+	nr_pages = EFI_SIZE_TO_PAGES(size);
+	pg->dma = gfp_dma(flags);
+	base = kmem_alloc_pages(&nr_pages, align, pg->dma,
+				kmem_atomic(flags, tpl));
+	if (!base) {
+		__kfree(&kmem_page_cache, pg);
+		return NULL;
 	}
 
-	if (align == 0)
-		align = 8;
+	pg->pfn = virt_to_pfn(base);
+	pg->nr_pages = nr_pages;
+	pg->type = KMEM_PAGE_LARGE;
 
-	if (align == 8)
-		type = MEMTYPE_POOL;
-	else
-		type = MEMTYPE_ALIGNED_PAGES;
+	/* Boot services pages come with whatever was there before */
+	if (flags & __GFP_ZERO)
+		memset(base, 0, nr_pages << PAGE_SHIFT);
 
-	head_size = ALIGN_VALUE(sizeof(*head), align);
-	base_size = head_size + size;
+	tpl = kmem_lock();
+	kmem_page_insert(pg);
+	kmem_unlock(tpl);
 
-	if (type == MEMTYPE_POOL)
-		base_mem = AllocatePool(base_size);
-	else if (type == MEMTYPE_ALIGNED_PAGES)
-		base_mem = AllocateAlignedPages(EFI_SIZE_TO_PAGES(base_size), align);
-	else
-		BUG();
-	if (base_mem == NULL) {
-		return NULL;
+	return base;
+}
+
+static void *do_kmalloc_large(size_t size, gfp_t flags, unsigned long caller)
+{
+	void *ret = __kmalloc_large(size, flags, PAGE_SIZE);
+
+	kmem_profile_alloc(ret, size, caller);
+	return ret;
+}
+
+void *kmalloc_large_caller(size_t size, gfp_t flags, unsigned long caller)
+{
+	void *ret = do_kmalloc_large(size, flags, caller);
+
+	kmem_trace_record(KMALLOC_TRACE_ALLOC, ret, NULL, size, 0, flags);
+	return ret;
+}
+
+void *kmalloc_large(size_t size, gfp_t flags)
+{
+	return kmalloc_large_caller(size, flags, _RET_IP_);
+}
+EXPORT_SYMBOL(kmalloc_large);
+
+void *kmalloc_large_aligned(size_t size, gfp_t flags, size_t align,
+			    unsigned long caller)
+{
+	void *ret;
+
+	ret = __kmalloc_large(size, flags, max_t(size_t, align, PAGE_SIZE));
+	kmem_profile_alloc(ret, size, caller);
+	kmem_trace_record(KMALLOC_TRACE_ALLOC, ret, NULL, size, align, flags);
+	return ret;
+}
+
+/*
+ * Resize the page run holding @p without moving it. Shrinking hands the
+ * tail pages back, growing only works if the pages right behind the run
+ * are free. The caller owns @p, so its descriptor stays put while the
+ * lock is dropped around the page calls.
+ */
+static bool kmalloc_large_resize(const void *p, size_t new_size, gfp_t flags,
+				 EFI_TPL tpl)
+{
+	unsigned long nr_pages = EFI_SIZE_TO_PAGES(new_size);
+	unsigned long pfn, old_nr;
+	struct kmem_page *pg;
+	bool dma;
+
+	kmem_lock();
+	pg = kmem_page_lookup(p);
+	if (!pg || pg->type != KMEM_PAGE_LARGE) {
+		kmem_unlock(tpl);
+		return false;
 	}
+	pfn = pg->pfn;
+	old_nr = pg->nr_pages;
+	dma = pg->dma;
+	if (nr_pages < old_nr)
+		pg->nr_pages = nr_pages;
+	kmem_unlock(tpl);
 
-	head = base_mem + head_size - sizeof(*head);
-	head->signature = KMEM_HEAD_SIGNATURE;
-	head->base_ptr = base_mem;
-	head->base_size = base_size;
-	head->flags = flags;
-	head->size = size;
-	head->align = align;
-	head->type = type;
+	if (nr_pages < old_nr) {
+		kmem_free_pages(pfn_to_virt(pfn + nr_pages), old_nr - nr_pages,
+				tpl);
+	} else if (nr_pages > old_nr) {
+		if (!kmem_grow_pages(pfn, old_nr, nr_pages - old_nr, dma))
+			return false;
+		if (flags & __GFP_ZERO)
+			memset(pfn_to_virt(pfn + old_nr), 0,
+			       (nr_pages - old_nr) << PAGE_SHIFT);
 
-	return head->data;
+		kmem_lock();
+		pg->nr_pages = nr_pages;
+		kmem_run_max_pages = max(kmem_run_max_pages, nr_pages);
+		kmem_unlock(tpl);
+	}
+
+	return true;
 }
 
 void *__kmalloc(size_t size, gfp_t flags) {
-	if (!size) {
-		return ZERO_SIZE_PTR;
-	}
+	void *ret = do_kmalloc(size, flags, _RET_IP_);
 
-	return __do_alloc(size, flags, 8);
+	kmem_trace_record(KMALLOC_TRACE_ALLOC, ret, NULL, size, 0, flags);
+	return ret;
 }
 EXPORT_SYMBOL(__kmalloc);
 
-static __always_inline struct mem_head* get_mem_head(const void *p) {
-	struct mem_head *head;
-
-	head = BASE_CR(p, struct mem_head, data);
-	BUG_ON(head->signature != KMEM_HEAD_SIGNATURE);
+void *__kmalloc_track_caller(size_t size, gfp_t flags, unsigned long caller) {
+	void *ret = do_kmalloc(size, flags, caller);
 
-	return head;
+	kmem_trace_record(KMALLOC_TRACE_ALLOC, ret, NULL, size, 0, flags);
+	return ret;
 }
+EXPORT_SYMBOL(__kmalloc_track_caller);
 
 void kfree(const void *p) {
-	struct mem_head *head;
-
 	if (unlikely(ZERO_OR_NULL_PTR(p)))
 		return;
 
-	head = get_mem_head(p);
-	BUG_ON(!head);
-
-	if (head->type == MEMTYPE_POOL)
-		FreePool (head->base_ptr);
-	else if (head->type == MEMTYPE_ALIGNED_PAGES)
-		FreeAlignedPages (head->base_ptr, EFI_SIZE_TO_PAGES(head->base_size));
-	else
-		BUG();
+	kmem_trace_record(KMALLOC_TRACE_FREE, p, NULL, 0, 0, 0);
+	__kfree(NULL, p);
 }
 EXPORT_SYMBOL(kfree);
 
 size_t ksize(const void *p) {
-	struct mem_head *head;
+	struct kmem_page *pg;
+	size_t size;
+	EFI_TPL tpl;
 
 	BUG_ON(!p);
 
 	if (unlikely(p == ZERO_SIZE_PTR))
 		return 0;
 
-	head = get_mem_head(p);
-	BUG_ON(!head);
+	tpl = kmem_lock();
+	pg = kmem_page_lookup(p);
+	BUG_ON(!pg);
 
-	return head->size;
+	if (pg->type == KMEM_PAGE_LARGE)
+		size = pg->nr_pages << PAGE_SHIFT;
+	else
+		size = container_of(pg, struct slab, page)->cache->object_size;
+	kmem_unlock(tpl);
+
+	return size;
 }
 EXPORT_SYMBOL(ksize);
+
+/* Whether @p is anywhere inside a large run */
+bool kmem_in_page_run(const void *p)
+{
+	struct kmem_page *pg;
+	EFI_TPL tpl;
+
+	tpl = kmem_lock();
+	pg = kmem_page_lookup(p);
+	if (!pg)
+		pg = kmem_run_lookup(virt_to_pfn(p));
+	kmem_unlock(tpl);
+
+	return pg && pg->type == KMEM_PAGE_LARGE;
+}
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Page fragment allocator, after the one in linux/mm/page_alloc.c
+ *
+ * There is no struct page to keep the reference count in, so it sits at
+ * the bottom of the block and fragments are carved from the top down to
+ * it. Blocks are naturally aligned page runs of PAGE_FRAG_CACHE_MAX_SIZE
+ * bytes from kmalloc.c, masking a fragment address gives its block.
+ */
+
+#include <LinuxBase.h>
+#include <linux/gfp.h>
+#include <linux/mm_types.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/export.h>
+#include <linux/bug.h>
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "slab.h"
+
+struct page_frag_head {
+	unsigned long refcount;
+};
+
+#define PAGE_FRAG_HEAD_SIZE	sizeof(struct page_frag_head)
+
+static inline struct page_frag_head *page_frag_head(const void *addr)
+{
+	return (void *)((unsigned long)addr & ~(PAGE_FRAG_CACHE_MAX_SIZE - 1));
+}
+
+/*
+ * Fragments may be freed from event notification functions, the count
+ * only changes with the TPL raised.
+ */
+static bool page_frag_ref_sub_and_test(struct page_frag_head *head,
+				       unsigned int nr)
+{
+	EFI_TPL tpl;
+	bool last;
+
+	tpl = gBS->RaiseTPL(TPL_HIGH_LEVEL);
+	head->refcount -= nr;
+	last = !head->refcount;
+	gBS->RestoreTPL(tpl);
+
+	return last;
+}
+
+static void *__page_frag_cache_refill(struct page_frag_cache *nc,
+				      gfp_t gfp_mask)
+{
+	struct page_frag_head *head;
+
+	head = kmalloc_large_aligned(PAGE_FRAG_CACHE_MAX_SIZE,
+				     gfp_mask & ~__GFP_ZERO,
+				     PAGE_FRAG_CACHE_MAX_SIZE, _RET_IP_);
+	nc->va = head;
+	if (!head)
+		return NULL;
+
+	/* Nobody else knows about the block yet */
+	head->refcount = PAGE_FRAG_CACHE_MAX_SIZE + 1;
+	return head;
+}
+
+/**
+ * page_frag_cache_drain - drop the cache's hold on its current block
+ * @nc: the fragment cache
+ *
+ * The block is freed once all of its fragments are, the next allocation
+ * from @nc starts a new one.
+ */
+void page_frag_cache_drain(struct page_frag_cache *nc)
+{
+	if (!nc->va)
+		return;
+
+	if (page_frag_ref_sub_and_test(nc->va, nc->pagecnt_bias))
+		kfree(nc->va);
+	nc->va = NULL;
+}
+EXPORT_SYMBOL(page_frag_cache_drain);
+
+/**
+ * page_frag_alloc_align - allocate a fragment
+ * @nc: the fragment cache to allocate from
+ * @fragsz: size of the fragment
+ * @gfp_mask: the usual allocation bitmask
+ * @align: alignment of the fragment, a power of two
+ *
+ * The caller serializes the use of @nc, the fragments can be freed with
+ * page_frag_free() from anywhere. Returns %NULL if @fragsz does not fit
+ * into a block, @align exceeds %PAGE_FRAG_CACHE_MAX_SIZE, or no block
+ * could be allocated.
+ */
+void *page_frag_alloc_align(struct page_frag_cache *nc, unsigned int fragsz,
+			    gfp_t gfp_mask, unsigned int align)
+{
+	struct page_frag_head *head;
+	unsigned int offset;
+
+	if (WARN_ON_ONCE(align > PAGE_FRAG_CACHE_MAX_SIZE))
+		return NULL;
+
+	/* The block has to hold the head and, above it, the aligned fragment */
+	if (unlikely(ALIGN(PAGE_FRAG_HEAD_SIZE, align) >=
+		     PAGE_FRAG_CACHE_MAX_SIZE ||
+		     fragsz > PAGE_FRAG_CACHE_MAX_SIZE -
+			      ALIGN(PAGE_FRAG_HEAD_SIZE, align)))
+		return NULL;
+
+	if (unlikely(!nc->va)) {
+refill:
+		if (!__page_frag_cache_refill(nc, gfp_mask))
+			return NULL;
+
+		nc->pagecnt_bias = PAGE_FRAG_CACHE_MAX_SIZE + 1;
+		nc->offset = PAGE_FRAG_CACHE_MAX_SIZE;
+	}
+
+	head = nc->va;
+	if (unlikely(nc->offset < fragsz ||
+		     ((nc->offset - fragsz) & ~(align - 1)) <
+		     PAGE_FRAG_HEAD_SIZE)) {
+		/* All fragments handed out, unless they all came back */
+		if (!page_frag_ref_sub_and_test(head, nc->pagecnt_bias))
+			goto refill;
+
+		/* OK, block count is 0, we can safely set it */
+		head->refcount = PAGE_FRAG_CACHE_MAX_SIZE + 1;
+
+		/* reset page count bias and offset to start of new frag */
+		nc->pagecnt_bias = PAGE_FRAG_CACHE_MAX_SIZE + 1;
+		nc->offset = PAGE_FRAG_CACHE_MAX_SIZE;
+	}
+
+	offset = (nc->offset - fragsz) & ~(align - 1);
+	nc->pagecnt_bias--;
+	nc->offset = offset;
+
+	if (unlikely(gfp_mask & __GFP_ZERO))
+		memset((void *)head + offset, 0, fragsz);
+
+	return (void *)head + offset;
+}
+EXPORT_SYMBOL(page_frag_alloc_align);
+
+/**
+ * page_frag_free - free a fragment
+ * @addr: the fragment, as returned by page_frag_alloc()
+ */
+void page_frag_free(void *addr)
+{
+	struct page_frag_head *head = page_frag_head(addr);
+
+	if (unlikely(page_frag_ref_sub_and_test(head, 1)))
+		kfree(head);
+}
+EXPORT_SYMBOL(page_frag_free);
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LIB_SLAB_H
+#define _LIB_SLAB_H
+
+#include <linux/gfp.h>
+
+/* Whether @p points into a run of pages of its own rather than a slab */
+bool kmem_in_page_run(const void *p);
+
+/* kmalloc_large() on behalf of @caller, for allocation profiling */
+void *kmalloc_large_caller(size_t size, gfp_t flags, unsigned long caller);
+
+/* The same for a run aligned to @align, page_frag wants its own size */
+void *kmalloc_large_aligned(size_t size, gfp_t flags, size_t align,
+			    unsigned long caller);
+
+#endif
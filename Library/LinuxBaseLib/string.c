@@ -28,11 +28,161 @@
 #include <linux/export.h>
 #include <linux/bug.h>
 #include <linux/errno.h>
+#include <linux/bitops.h>
 
 #include <asm/byteorder.h>
 #include <asm/word-at-a-time.h>
+#include <asm/unaligned.h>
 #include <asm/page.h>
 
+/*
+ * The scans below read the string or area in whole aligned words. A word
+ * holding at least one byte that the caller may read cannot cross a page
+ * boundary, so reading its other bytes is always safe.
+ */
+
+/* The first @n bytes, in memory order, of a word */
+static inline unsigned long leading_byte_mask(unsigned int n)
+{
+#ifdef __BIG_ENDIAN
+	return ~(~0ul >> (8 * n));
+#else
+	return (1ul << (8 * n)) - 1;
+#endif
+}
+
+/*
+ * Find the first byte of a word that is zero in @a or @b, returns its
+ * index or sizeof(unsigned long) if there is none.
+ */
+static inline unsigned int find_zero2(unsigned long a, unsigned long b)
+{
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+	unsigned long data, mask = 0;
+
+	if (has_zero(a, &data, &constants))
+		mask = prep_zero_mask(a, data, &constants);
+	if (has_zero(b, &data, &constants))
+		mask |= prep_zero_mask(b, data, &constants);
+	if (!mask)
+		return sizeof(unsigned long);
+
+	return find_zero(create_zero_mask(mask));
+}
+
+/* Find the first byte of a string that is either NUL or @c */
+static inline const char *__strchrnul(const char *s, int c)
+{
+	unsigned long rep = REPEAT_BYTE((u8)c);
+	unsigned int align = (unsigned long)s & (sizeof(unsigned long) - 1);
+	unsigned long skip = leading_byte_mask(align);
+	const char *p = s - align;
+	unsigned long val;
+	unsigned int i;
+
+	for (;;) {
+		val = read_word_at_a_time(p);
+		i = find_zero2(val | skip, (val ^ rep) | skip);
+		if (i < sizeof(unsigned long))
+			return p + i;
+		p += sizeof(unsigned long);
+		skip = 0;
+	}
+}
+
+/* Find the first @c in an area, %NULL if there is none */
+static inline const void *__memchr(const void *s, int c, size_t n)
+{
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+	unsigned long rep = REPEAT_BYTE((u8)c);
+	unsigned int align = (unsigned long)s & (sizeof(unsigned long) - 1);
+	unsigned long end = (unsigned long)s + n;
+	const char *p = s - align;
+	unsigned long val, data;
+
+	if (!n)
+		return NULL;
+	if (end < (unsigned long)s)
+		end = ULONG_MAX;
+
+	val = (read_word_at_a_time(p) ^ rep) | leading_byte_mask(align);
+	while (!has_zero(val, &data, &constants)) {
+		p += sizeof(unsigned long);
+		if ((unsigned long)p >= end)
+			return NULL;
+		val = read_word_at_a_time(p) ^ rep;
+	}
+
+	data = prep_zero_mask(val, data, &constants);
+	p += find_zero(create_zero_mask(data));
+	return (unsigned long)p < end ? p : NULL;
+}
+
+#if !defined(__HAVE_ARCH_STRNCASECMP) || !defined(__HAVE_ARCH_STRCASECMP)
+/*
+ * Lower case the ASCII letters of a word, other bytes are left alone.
+ * Below 0x80, adding 0x80 - 'A' sets the top bit of a byte from 'A' on,
+ * adding 0x80 - 'Z' - 1 that of a byte past 'Z'.
+ */
+static inline unsigned long fold_case_word(unsigned long w)
+{
+	unsigned long high = REPEAT_BYTE(0x80);
+	unsigned long low = w & ~high;
+	unsigned long upper = (low + REPEAT_BYTE(0x80 - 'A')) &
+			      ~(low + REPEAT_BYTE(0x80 - 'Z' - 1)) & ~w & high;
+
+	return w | upper >> 2;
+}
+
+/*
+ * Case insensitive compare of at most @len bytes. Words that match after
+ * folding ASCII case and hold no NUL are skipped whole, the first other
+ * one goes through tolower(), which knows Latin-1 as well. Words of @s1
+ * are read aligned, those of @s2 unaligned but not across a page.
+ */
+static int __strncasecmp(const char *s1, const char *s2, size_t len)
+{
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+	/* Yes, Virginia, it had better be unsigned */
+	unsigned char c1, c2;
+	unsigned long a, b, data;
+	size_t n;
+
+	while (len) {
+		n = 1;
+		if (!((unsigned long)s1 & (sizeof(unsigned long) - 1)) &&
+		    len >= sizeof(unsigned long) &&
+		    ((unsigned long)s2 & ~PAGE_MASK) <=
+		    PAGE_SIZE - sizeof(unsigned long)) {
+			a = read_word_at_a_time(s1);
+			b = get_unaligned((const unsigned long *)s2);
+			if (!has_zero(a, &data, &constants) &&
+			    fold_case_word(a) == fold_case_word(b)) {
+				s1 += sizeof(unsigned long);
+				s2 += sizeof(unsigned long);
+				len -= sizeof(unsigned long);
+				continue;
+			}
+			n = sizeof(unsigned long);
+		}
+
+		for (len -= n; n; n--) {
+			c1 = *s1++;
+			c2 = *s2++;
+			if (!c1 || !c2)
+				return (int)c1 - (int)c2;
+			if (c1 == c2)
+				continue;
+			c1 = tolower(c1);
+			c2 = tolower(c2);
+			if (c1 != c2)
+				return (int)c1 - (int)c2;
+		}
+	}
+	return 0;
+}
+#endif
+
 #ifndef __HAVE_ARCH_STRNCASECMP
 /**
  * strncasecmp - Case insensitive, length-limited string comparison
@@ -42,25 +192,7 @@
  */
 int strncasecmp(const char *s1, const char *s2, size_t len)
 {
-	/* Yes, Virginia, it had better be unsigned */
-	unsigned char c1, c2;
-
-	if (!len)
-		return 0;
-
-	do {
-		c1 = *s1++;
-		c2 = *s2++;
-		if (!c1 || !c2)
-			break;
-		if (c1 == c2)
-			continue;
-		c1 = tolower(c1);
-		c2 = tolower(c2);
-		if (c1 != c2)
-			break;
-	} while (--len);
-	return (int)c1 - (int)c2;
+	return __strncasecmp(s1, s2, len);
 }
 EXPORT_SYMBOL(strncasecmp);
 #endif
@@ -68,13 +200,7 @@ EXPORT_SYMBOL(strncasecmp);
 #ifndef __HAVE_ARCH_STRCASECMP
 int strcasecmp(const char *s1, const char *s2)
 {
-	int c1, c2;
-
-	do {
-		c1 = tolower(*s1++);
-		c2 = tolower(*s2++);
-	} while (c1 == c2 && c1 != 0);
-	return c1 - c2;
+	return __strncasecmp(s1, s2, SIZE_MAX);
 }
 EXPORT_SYMBOL(strcasecmp);
 #endif
@@ -370,10 +496,8 @@ EXPORT_SYMBOL(strncmp);
  */
 char *strchr(const char *s, int c)
 {
-	for (; *s != (char)c; ++s)
-		if (*s == '\0')
-			return NULL;
-	return (char *)s;
+	s = __strchrnul(s, c);
+	return *s == (char)c ? (char *)s : NULL;
 }
 EXPORT_SYMBOL(strchr);
 #endif
@@ -389,9 +513,7 @@ EXPORT_SYMBOL(strchr);
  */
 char *strchrnul(const char *s, int c)
 {
-	while (*s && *s != (char)c)
-		s++;
-	return (char *)s;
+	return (char *)__strchrnul(s, c);
 }
 EXPORT_SYMBOL(strchrnul);
 #endif
@@ -476,13 +598,10 @@ EXPORT_SYMBOL(strim);
  * strlen - Find the length of a string
  * @s: The string to be sized
  */
+#undef strlen
 size_t strlen(const char *s)
 {
-	const char *sc;
-
-	for (sc = s; *sc != '\0'; ++sc)
-		/* nothing */;
-	return sc - s;
+	return __strchrnul(s, 0) - s;
 }
 EXPORT_SYMBOL(strlen);
 #endif
@@ -495,15 +614,44 @@ EXPORT_SYMBOL(strlen);
  */
 size_t strnlen(const char *s, size_t count)
 {
-	const char *sc;
+	const char *sc = __memchr(s, 0, count);
 
-	for (sc = s; count-- && *sc != '\0'; ++sc)
-		/* nothing */;
-	return sc - s;
+	return sc ? sc - s : count;
 }
 EXPORT_SYMBOL(strnlen);
 #endif
 
+#if !defined(__HAVE_ARCH_STRSPN) || !defined(__HAVE_ARCH_STRCSPN) || \
+    !defined(__HAVE_ARCH_STRPBRK)
+/*
+ * Length of the initial run of @s made of bytes in @set, or with @reject
+ * of bytes not in it. The set is turned into a 256 bit map first, so the
+ * scan costs one lookup per byte however long @set is. NUL is never in
+ * @set, and it is added to the map for @reject: either way the scan stops
+ * at the end of @s.
+ */
+static size_t __strspn(const char *s, const char *set, bool reject)
+{
+	unsigned long map[256 / BITS_PER_LONG] = { 0 };
+	const unsigned char *p = (const unsigned char *)set;
+
+	if (!p[0])
+		return reject ? strlen(s) : 0;
+	if (reject && !p[1])
+		return __strchrnul(s, p[0]) - s;
+
+	for (; *p; p++)
+		map[BIT_WORD(*p)] |= BIT_MASK(*p);
+	if (reject)
+		map[0] |= 1;
+
+	for (p = (const unsigned char *)s;
+	     !!(map[BIT_WORD(*p)] & BIT_MASK(*p)) != reject; p++)
+		;
+	return p - (const unsigned char *)s;
+}
+#endif
+
 #ifndef __HAVE_ARCH_STRSPN
 /**
  * strspn - Calculate the length of the initial substring of @s which only contain letters in @accept
@@ -512,20 +660,7 @@ EXPORT_SYMBOL(strnlen);
  */
 size_t strspn(const char *s, const char *accept)
 {
-	const char *p;
-	const char *a;
-	size_t count = 0;
-
-	for (p = s; *p != '\0'; ++p) {
-		for (a = accept; *a != '\0'; ++a) {
-			if (*p == *a)
-				break;
-		}
-		if (*a == '\0')
-			return count;
-		++count;
-	}
-	return count;
+	return __strspn(s, accept, false);
 }
 
 EXPORT_SYMBOL(strspn);
@@ -539,18 +674,7 @@ EXPORT_SYMBOL(strspn);
  */
 size_t strcspn(const char *s, const char *reject)
 {
-	const char *p;
-	const char *r;
-	size_t count = 0;
-
-	for (p = s; *p != '\0'; ++p) {
-		for (r = reject; *r != '\0'; ++r) {
-			if (*p == *r)
-				return count;
-		}
-		++count;
-	}
-	return count;
+	return __strspn(s, reject, true);
 }
 EXPORT_SYMBOL(strcspn);
 #endif
@@ -563,15 +687,8 @@ EXPORT_SYMBOL(strcspn);
  */
 char *strpbrk(const char *cs, const char *ct)
 {
-	const char *sc1, *sc2;
-
-	for (sc1 = cs; *sc1 != '\0'; ++sc1) {
-		for (sc2 = ct; *sc2 != '\0'; ++sc2) {
-			if (*sc1 == *sc2)
-				return (char *)sc1;
-		}
-	}
-	return NULL;
+	cs += __strspn(cs, ct, true);
+	return *cs ? (char *)cs : NULL;
 }
 EXPORT_SYMBOL(strpbrk);
 #endif
@@ -693,6 +810,7 @@ EXPORT_SYMBOL(__sysfs_match_string);
  *
  * Do not use memset() to access IO space, use memset_io() instead.
  */
+#undef memset
 void *memset(void *s, int c, size_t count)
 {
 	char *xs = s;
@@ -725,6 +843,61 @@ void memzero_explicit(void *s, size_t count)
 }
 EXPORT_SYMBOL(memzero_explicit);
 
+#if !defined(__HAVE_ARCH_MEMSET16) || !defined(__HAVE_ARCH_MEMSET32) || \
+    !defined(__HAVE_ARCH_MEMSET64)
+/* One element of @size bytes, @pattern holds it repeated over a word */
+static __always_inline void store_element(void *p, unsigned long pattern,
+					  size_t size)
+{
+	switch (size) {
+	case 2:
+		*(u16 *)p = pattern;
+		break;
+	case 4:
+		*(u32 *)p = pattern;
+		break;
+	default:
+		*(unsigned long *)p = pattern;
+		break;
+	}
+}
+
+/*
+ * Fill @count elements of @size bytes, with @s aligned to @size. The
+ * elements up to the first aligned word and after the last one are
+ * stored one by one, the words in between eight at a time.
+ */
+static __always_inline void *memset_words(void *s, unsigned long pattern,
+					  size_t size, size_t count)
+{
+	size_t n = count * size;
+	unsigned long *d;
+	u8 *p = s;
+
+	for (; n && !IS_ALIGNED((unsigned long)p, sizeof(long));
+	     n -= size, p += size)
+		store_element(p, pattern, size);
+
+	d = (unsigned long *)p;
+	for (; n >= 8 * sizeof(long); n -= 8 * sizeof(long), d += 8) {
+		d[0] = pattern;
+		d[1] = pattern;
+		d[2] = pattern;
+		d[3] = pattern;
+		d[4] = pattern;
+		d[5] = pattern;
+		d[6] = pattern;
+		d[7] = pattern;
+	}
+	for (; n >= sizeof(long); n -= sizeof(long))
+		*d++ = pattern;
+
+	for (p = (u8 *)d; n; n -= size, p += size)
+		store_element(p, pattern, size);
+	return s;
+}
+#endif
+
 #ifndef __HAVE_ARCH_MEMSET16
 /**
  * memset16() - Fill a memory area with a uint16_t
@@ -738,11 +911,7 @@ EXPORT_SYMBOL(memzero_explicit);
  */
 void *memset16(uint16_t *s, uint16_t v, size_t count)
 {
-	uint16_t *xs = s;
-
-	while (count--)
-		*xs++ = v;
-	return s;
+	return memset_words(s, v * (~0UL / 0xffff), sizeof(v), count);
 }
 EXPORT_SYMBOL(memset16);
 #endif
@@ -760,11 +929,7 @@ EXPORT_SYMBOL(memset16);
  */
 void *memset32(uint32_t *s, uint32_t v, size_t count)
 {
-	uint32_t *xs = s;
-
-	while (count--)
-		*xs++ = v;
-	return s;
+	return memset_words(s, v * (~0UL / 0xffffffff), sizeof(v), count);
 }
 EXPORT_SYMBOL(memset32);
 #endif
@@ -784,6 +949,15 @@ void *memset64(uint64_t *s, uint64_t v, size_t count)
 {
 	uint64_t *xs = s;
 
+	if (BITS_PER_LONG == 64)
+		return memset_words(s, v, sizeof(v), count);
+
+	for (; count >= 4; count -= 4, xs += 4) {
+		xs[0] = v;
+		xs[1] = v;
+		xs[2] = v;
+		xs[3] = v;
+	}
 	while (count--)
 		*xs++ = v;
 	return s;
@@ -801,6 +975,7 @@ EXPORT_SYMBOL(memset64);
  * You should not use this function to access IO space, use memcpy_toio()
  * or memcpy_fromio() instead.
  */
+#undef memcpy
 void *memcpy(void *dest, const void *src, size_t count)
 {
 	char *tmp = dest;
@@ -845,6 +1020,33 @@ void *memmove(void *dest, const void *src, size_t count)
 EXPORT_SYMBOL(memmove);
 #endif
 
+/* Index of the first byte that differs between two areas, or @count */
+static inline size_t memdiff(const void *cs, const void *ct, size_t count)
+{
+	const unsigned char *su1 = cs, *su2 = ct;
+	size_t i = 0;
+
+	/* Compare whole words if both areas can be aligned at the same time */
+	if (!(((unsigned long)cs ^ (unsigned long)ct) &
+	      (sizeof(unsigned long) - 1))) {
+		for (; i < count &&
+		       ((unsigned long)(su1 + i) & (sizeof(unsigned long) - 1));
+		     i++)
+			if (su1[i] != su2[i])
+				return i;
+		for (; count - i >= sizeof(unsigned long);
+		     i += sizeof(unsigned long))
+			if (*(const unsigned long *)(su1 + i) !=
+			    *(const unsigned long *)(su2 + i))
+				break;
+	}
+
+	for (; i < count; i++)
+		if (su1[i] != su2[i])
+			break;
+	return i;
+}
+
 #ifndef __HAVE_ARCH_MEMCMP
 /**
  * memcmp - Compare two areas of memory
@@ -855,17 +1057,23 @@ EXPORT_SYMBOL(memmove);
 #undef memcmp
 __visible int memcmp(const void *cs, const void *ct, size_t count)
 {
-	const unsigned char *su1, *su2;
-	int res = 0;
+	const unsigned char *su1 = cs, *su2 = ct;
+	size_t i = memdiff(cs, ct, count);
 
-	for (su1 = cs, su2 = ct; 0 < count; ++su1, ++su2, count--)
-		if ((res = *su1 - *su2) != 0)
-			break;
-	return res;
+	return i < count ? su1[i] - su2[i] : 0;
 }
 EXPORT_SYMBOL(memcmp);
 #endif
 
+#ifndef __HAVE_ARCH_MEMEQ
+/* Out of line part of memeq() */
+bool __memeq(const void *cs, const void *ct, size_t count)
+{
+	return memdiff(cs, ct, count) == count;
+}
+EXPORT_SYMBOL(__memeq);
+#endif
+
 #ifndef __HAVE_ARCH_MEMSCAN
 /**
  * memscan - Find a character in an area of memory.
@@ -878,19 +1086,164 @@ EXPORT_SYMBOL(memcmp);
  */
 void *memscan(void *addr, int c, size_t size)
 {
-	unsigned char *p = addr;
+	const void *p = __memchr(addr, c, size);
 
-	while (size) {
-		if (*p == c)
-			return (void *)p;
-		p++;
-		size--;
-	}
-  	return (void *)p;
+	return p ? (void *)p : addr + size;
 }
 EXPORT_SYMBOL(memscan);
 #endif
 
+/*
+ * Two-way string matching, after Crochemore and Perrin, "Two-way string
+ * matching", JACM 38(3), 1991. The needle is split at a critical
+ * factorization into u and v, the right half v is matched left to right,
+ * then u right to left. Each haystack byte is looked at a bounded number
+ * of times and no tables are needed.
+ */
+
+/*
+ * Returns the start of v and sets @period to the period of v. The
+ * maximal suffix is computed for both orderings of the bytes, the longer
+ * one gives a critical factorization.
+ */
+static size_t two_way_factorize(const u8 *needle, size_t n, size_t *period)
+{
+	size_t max_suffix, max_suffix_rev, j, k, p;
+	u8 a, b;
+
+	/* Indices start at -1 so that max_suffix + k is the byte compared */
+	max_suffix = SIZE_MAX;
+	j = 0;
+	k = p = 1;
+	while (j + k < n) {
+		a = needle[j + k];
+		b = needle[max_suffix + k];
+		if (a < b) {
+			j += k;
+			k = 1;
+			p = j - max_suffix;
+		} else if (a == b) {
+			if (k != p) {
+				k++;
+			} else {
+				j += p;
+				k = 1;
+			}
+		} else {
+			max_suffix = j++;
+			k = p = 1;
+		}
+	}
+	*period = p;
+
+	max_suffix_rev = SIZE_MAX;
+	j = 0;
+	k = p = 1;
+	while (j + k < n) {
+		a = needle[j + k];
+		b = needle[max_suffix_rev + k];
+		if (b < a) {
+			j += k;
+			k = 1;
+			p = j - max_suffix_rev;
+		} else if (a == b) {
+			if (k != p) {
+				k++;
+			} else {
+				j += p;
+				k = 1;
+			}
+		} else {
+			max_suffix_rev = j++;
+			k = p = 1;
+		}
+	}
+
+	if (max_suffix_rev + 1 < max_suffix + 1)
+		return max_suffix + 1;
+	*period = p;
+	return max_suffix_rev + 1;
+}
+
+static const u8 *two_way_search(const u8 *hay, size_t hlen, const u8 *needle,
+				size_t n)
+{
+	size_t suffix, period, memory = 0, i, j = 0;
+	const u8 *p;
+	bool periodic;
+
+	suffix = two_way_factorize(needle, n, &period);
+	periodic = memeq(needle, needle + period, suffix);
+	if (!periodic)
+		period = max(suffix, n - suffix) + 1;
+
+	while (j <= hlen - n) {
+		/*
+		 * Nothing is known about this window, skip to the next one
+		 * where at least the first byte of v matches.
+		 */
+		if (!memory) {
+			p = memchr(hay + j + suffix, needle[suffix],
+				   hlen - n - j + 1);
+			if (!p)
+				return NULL;
+			j = p - hay - suffix;
+		}
+
+		/* Match v left to right */
+		i = max(suffix, memory);
+		while (i < n && needle[i] == hay[i + j])
+			i++;
+		if (i < n) {
+			j += i - suffix + 1;
+			memory = 0;
+			continue;
+		}
+
+		/*
+		 * Then u right to left. For a periodic needle, the part that
+		 * the last window matched is known to match again.
+		 */
+		i = suffix;
+		while (i > memory && needle[i - 1] == hay[i - 1 + j])
+			i--;
+		if (i <= memory)
+			return hay + j;
+
+		j += period;
+		if (periodic)
+			memory = n - period;
+	}
+
+	return NULL;
+}
+
+#ifndef __HAVE_ARCH_MEMMEM
+/**
+ * memmem - Find the first occurrence of a byte sequence in an area
+ * @haystack: The area to be searched
+ * @haystacklen: The size of the area
+ * @needle: The bytes to search for
+ * @needlelen: The number of bytes to search for
+ *
+ * Runs in time linear in @haystacklen + @needlelen.
+ */
+void *memmem(const void *haystack, size_t haystacklen, const void *needle,
+	     size_t needlelen)
+{
+	if (!needlelen)
+		return (void *)haystack;
+	if (needlelen > haystacklen)
+		return NULL;
+	if (needlelen == 1)
+		return memchr(haystack, *(const u8 *)needle, haystacklen);
+
+	return (void *)two_way_search(haystack, haystacklen, needle,
+				      needlelen);
+}
+EXPORT_SYMBOL(memmem);
+#endif
+
 #ifndef __HAVE_ARCH_STRSTR
 /**
  * strstr - Find the first substring in a %NUL terminated string
@@ -899,19 +1252,7 @@ EXPORT_SYMBOL(memscan);
  */
 char *strstr(const char *s1, const char *s2)
 {
-	size_t l1, l2;
-
-	l2 = strlen(s2);
-	if (!l2)
-		return (char *)s1;
-	l1 = strlen(s1);
-	while (l1 >= l2) {
-		l1--;
-		if (!memcmp(s1, s2, l2))
-			return (char *)s1;
-		s1++;
-	}
-	return NULL;
+	return memmem(s1, strlen(s1), s2, strlen(s2));
 }
 EXPORT_SYMBOL(strstr);
 #endif
@@ -922,21 +1263,12 @@ EXPORT_SYMBOL(strstr);
  * @s1: The string to be searched
  * @s2: The string to search for
  * @len: the maximum number of characters to search
+ *
+ * The search stops at the end of @s1 if that comes first.
  */
 char *strnstr(const char *s1, const char *s2, size_t len)
 {
-	size_t l2;
-
-	l2 = strlen(s2);
-	if (!l2)
-		return (char *)s1;
-	while (len >= l2) {
-		len--;
-		if (!memcmp(s1, s2, l2))
-			return (char *)s1;
-		s1++;
-	}
-	return NULL;
+	return memmem(s1, strnlen(s1, len), s2, strlen(s2));
 }
 EXPORT_SYMBOL(strnstr);
 #endif
@@ -953,17 +1285,12 @@ EXPORT_SYMBOL(strnstr);
  */
 void *memchr(const void *s, int c, size_t n)
 {
-	const unsigned char *p = s;
-	while (n-- != 0) {
-        	if ((unsigned char)c == *p++) {
-			return (void *)(p - 1);
-		}
-	}
-	return NULL;
+	return (void *)__memchr(s, c, n);
 }
 EXPORT_SYMBOL(memchr);
 #endif
 
+#ifndef __HAVE_ARCH_MEMCHR_INV
 static void *check_bytes8(const u8 *start, u8 value, unsigned int bytes)
 {
 	while (bytes) {
@@ -975,6 +1302,16 @@ static void *check_bytes8(const u8 *start, u8 value, unsigned int bytes)
 	return NULL;
 }
 
+/* Index of the first byte, in memory order, that is not zero in @x */
+static inline unsigned int first_nonzero_byte(unsigned long x)
+{
+#ifdef __BIG_ENDIAN
+	return (BITS_PER_LONG - 1 - __fls(x)) / 8;
+#else
+	return __ffs(x) / 8;
+#endif
+}
+
 /**
  * memchr_inv - Find an unmatching character in an area of memory.
  * @start: The memory area
@@ -986,49 +1323,39 @@ static void *check_bytes8(const u8 *start, u8 value, unsigned int bytes)
  */
 void *memchr_inv(const void *start, int c, size_t bytes)
 {
-	u8 value = c;
-	u64 value64;
-	unsigned int words, prefix;
+	unsigned long rep = REPEAT_BYTE((u8)c);
+	const u8 *p = start, *end = p + bytes;
+	const unsigned long *w;
+	unsigned long x;
 
 	if (bytes <= 16)
-		return check_bytes8(start, value, bytes);
-
-	value64 = value;
-#if defined(CONFIG_ARCH_HAS_FAST_MULTIPLIER) && BITS_PER_LONG == 64
-	value64 *= 0x0101010101010101ULL;
-#elif defined(CONFIG_ARCH_HAS_FAST_MULTIPLIER)
-	value64 *= 0x01010101;
-	value64 |= value64 << 32;
-#else
-	value64 |= value64 << 8;
-	value64 |= value64 << 16;
-	value64 |= value64 << 32;
-#endif
-
-	prefix = (unsigned long)start % 8;
-	if (prefix) {
-		u8 *r;
-
-		prefix = 8 - prefix;
-		r = check_bytes8(start, value, prefix);
-		if (r)
-			return r;
-		start += prefix;
-		bytes -= prefix;
-	}
+		return check_bytes8(start, c, bytes);
 
-	words = bytes / 8;
+	for (; !IS_ALIGNED((unsigned long)p, sizeof(long)); p++)
+		if (*p != (u8)c)
+			return (void *)p;
 
-	while (words) {
-		if (*(u64 *)start != value64)
-			return check_bytes8(start, value, 8);
-		start += 8;
-		words--;
+	/*
+	 * Eight words at a time until one of them differs, then that block
+	 * again a word at a time, which is where the position comes from.
+	 */
+	w = (const unsigned long *)p;
+	for (; (const u8 *)(w + 8) <= end; w += 8)
+		if ((w[0] ^ rep) | (w[1] ^ rep) | (w[2] ^ rep) |
+		    (w[3] ^ rep) | (w[4] ^ rep) | (w[5] ^ rep) |
+		    (w[6] ^ rep) | (w[7] ^ rep))
+			break;
+	for (; (const u8 *)(w + 1) <= end; w++) {
+		x = *w ^ rep;
+		if (x)
+			return (u8 *)w + first_nonzero_byte(x);
 	}
 
-	return check_bytes8(start, value, bytes % 8);
+	p = (const u8 *)w;
+	return check_bytes8(p, c, end - p);
 }
 EXPORT_SYMBOL(memchr_inv);
+#endif
 
 /**
  * strreplace - Replace all occurrences of character in string.
@@ -0,0 +1,317 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Precomputed matchers for match_string() style tables
+ *
+ * A minimal perfect hash after "Hash, displace, and compress" by
+ * Belazzougui, Botelho and Dietzfelbinger: the keys are spread over
+ * buckets by one half of their hash, and every bucket gets the smallest
+ * displacement that moves all of its keys to free slots. A lookup hashes
+ * the string once, reads the displacement of its bucket and compares
+ * against the one entry in the resulting slot. Slots keep the low half
+ * of the hash of their entry, so a miss rarely gets to the compare.
+ *
+ * sysfs_streq() also accepts the string with a trailing newline dropped
+ * or added, for a sysfs matcher those two are looked up as well. Their
+ * hashes fall out of hashing the string itself.
+ *
+ * Buckets hold STRING_MATCHER_LOAD keys on average and are placed the
+ * biggest first. Should some bucket find no free slots, which does not
+ * happen in practice, the build starts over with more slots than keys.
+ */
+
+#include <LinuxBase.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/bitmap.h>
+#include <linux/export.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+
+#define STRING_MATCHER_LOAD		4
+#define STRING_MATCHER_MAX_DISP		(1U << 16)
+#define STRING_MATCHER_EMPTY		U32_MAX
+
+#define STRING_MATCHER_HASH_INIT	0xcbf29ce484222325ULL
+
+/* FNV-1a, continuing from @hash */
+static u64 string_matcher_hash(u64 hash, const char *s, size_t len)
+{
+	while (len--) {
+		hash ^= (unsigned char)*s++;
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/*
+ * FNV-1a leaves the high bits, which pick the bucket, poorly mixed for
+ * strings that only differ at the end. Finish it with a 64 bit mixer.
+ */
+static inline u64 string_matcher_mix(u64 x)
+{
+	x ^= x >> 32;
+	x *= 0xd6e8feb86659fd93ULL;
+	x ^= x >> 32;
+	return x;
+}
+
+/* Multiply and shift in place of a division, @n is at most U32_MAX */
+static inline u32 string_matcher_reduce(u32 x, u32 n)
+{
+	return (u64)x * n >> 32;
+}
+
+static inline u32 string_matcher_bucket(const struct string_matcher *sm,
+					u64 hash)
+{
+	return string_matcher_reduce(hash >> 32, sm->nr_buckets);
+}
+
+static inline u32 string_matcher_slot(const struct string_matcher *sm,
+				      u64 hash, u32 disp)
+{
+	u64 x = string_matcher_mix(hash ^ (disp * 0x9e3779b97f4a7c15ULL));
+
+	return string_matcher_reduce(x, sm->nr_slots);
+}
+
+/*
+ * Place the buckets, whose keys are grouped in @keys from @start[b] on,
+ * into the slots. Returns false if some bucket did not fit.
+ */
+static bool string_matcher_place(struct string_matcher *sm, const u64 *hash,
+				 const u32 *keys, const u32 *start,
+				 unsigned long *taken, u32 max_size)
+{
+	u32 size, b, i, d;
+
+	bitmap_zero(taken, sm->nr_slots);
+	for (i = 0; i < sm->nr_slots; i++)
+		sm->slots[i].index = STRING_MATCHER_EMPTY;
+
+	for (size = max_size; size; size--) {
+		for (b = 0; b < sm->nr_buckets; b++) {
+			if (start[b + 1] - start[b] != size)
+				continue;
+
+			for (d = 0; d < STRING_MATCHER_MAX_DISP; d++) {
+				for (i = start[b]; i < start[b + 1]; i++) {
+					u32 slot = string_matcher_slot(sm,
+							hash[keys[i]], d);
+
+					if (test_bit(slot, taken))
+						break;
+					__set_bit(slot, taken);
+				}
+				if (i == start[b + 1])
+					break;
+
+				/* Take back the keys placed so far */
+				while (i-- > start[b])
+					__clear_bit(string_matcher_slot(sm,
+							hash[keys[i]], d),
+						    taken);
+			}
+			if (d == STRING_MATCHER_MAX_DISP)
+				return false;
+
+			sm->disp[b] = d;
+			for (i = start[b]; i < start[b + 1]; i++) {
+				u64 h = hash[keys[i]];
+				u32 slot = string_matcher_slot(sm, h, d);
+
+				sm->slots[slot].index = keys[i];
+				sm->slots[slot].tag = h;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * string_matcher_init - build a matcher over a table of strings
+ * @sm: the matcher
+ * @array: array of strings, must stay valid while @sm is used
+ * @n: number of strings in the array or -1 for NULL terminated arrays
+ * @sysfs: match like __sysfs_match_string() instead of match_string()
+ * @gfp: flags for the allocations
+ *
+ * Returns 0, -%ENOMEM, or -%E2BIG if @array has %INT_MAX or more
+ * strings. Where a string appears more than once, string_matcher_match()
+ * returns the first index, as match_string() does.
+ */
+int string_matcher_init(struct string_matcher *sm, const char * const *array,
+			size_t n, bool sysfs, gfp_t gfp)
+{
+	u32 *keys = NULL, *start = NULL;
+	unsigned long *taken = NULL;
+	u64 *hash = NULL;
+	u32 nr, i, j, b, end, unique, max_size = 0;
+	int ret = -ENOMEM;
+
+	memset(sm, 0, sizeof(*sm));
+	sm->array = array;
+	sm->sysfs = sysfs;
+
+	for (nr = 0; nr < n && array[nr]; nr++)
+		if (nr == INT_MAX - 1)
+			return -E2BIG;
+	if (!nr)
+		return 0;
+
+	sm->nr_buckets = DIV_ROUND_UP(nr, STRING_MATCHER_LOAD);
+	hash = kmalloc_array(nr, sizeof(*hash), gfp);
+	keys = kmalloc_array(nr, sizeof(*keys), gfp);
+	start = kcalloc(sm->nr_buckets + 1, sizeof(*start), gfp);
+	/* Lookups read the displacement of empty buckets as well */
+	sm->disp = kcalloc(sm->nr_buckets, sizeof(*sm->disp), gfp);
+	if (!hash || !keys || !start || !sm->disp)
+		goto out;
+
+	/* Group the keys by bucket, in ascending order within each */
+	for (i = 0; i < nr; i++) {
+		hash[i] = string_matcher_mix(string_matcher_hash(
+				STRING_MATCHER_HASH_INIT, array[i], strlen(array[i])));
+		start[string_matcher_bucket(sm, hash[i]) + 1]++;
+	}
+	for (b = 0; b < sm->nr_buckets; b++)
+		start[b + 1] += start[b];
+	for (i = 0; i < nr; i++)
+		keys[start[string_matcher_bucket(sm, hash[i])]++] = i;
+	for (b = sm->nr_buckets; b; b--)
+		start[b] = start[b - 1];
+	start[0] = 0;
+
+	/* Equal keys share a bucket, keep only the first of them */
+	for (b = 0, unique = 0; b < sm->nr_buckets; b++) {
+		i = start[b];
+		end = start[b + 1];
+		start[b] = unique;
+		for (; i < end; i++) {
+			u32 key = keys[i];
+
+			for (j = start[b]; j < unique; j++)
+				if (hash[keys[j]] == hash[key] &&
+				    !strcmp(array[keys[j]], array[key]))
+					break;
+			if (j == unique)
+				keys[unique++] = key;
+		}
+		max_size = max(max_size, unique - start[b]);
+	}
+	start[b] = unique;
+
+	sm->nr_slots = unique;
+	for (;;) {
+		sm->slots = kmalloc_array(sm->nr_slots, sizeof(*sm->slots),
+					  gfp);
+		taken = kcalloc(BITS_TO_LONGS(sm->nr_slots), sizeof(long), gfp);
+		if (!sm->slots || !taken)
+			goto out;
+
+		if (string_matcher_place(sm, hash, keys, start, taken,
+					 max_size))
+			break;
+
+		kfree(sm->slots);
+		kfree(taken);
+		sm->slots = NULL;
+		taken = NULL;
+		sm->nr_slots += sm->nr_slots / 8 + 1;
+	}
+
+	ret = 0;
+out:
+	kfree(taken);
+	kfree(start);
+	kfree(keys);
+	kfree(hash);
+	if (ret)
+		string_matcher_free(sm);
+	return ret;
+}
+EXPORT_SYMBOL(string_matcher_init);
+
+/**
+ * string_matcher_free - free what string_matcher_init() allocated
+ * @sm: the matcher
+ */
+void string_matcher_free(struct string_matcher *sm)
+{
+	kfree(sm->slots);
+	kfree(sm->disp);
+	memset(sm, 0, sizeof(*sm));
+}
+EXPORT_SYMBOL(string_matcher_free);
+
+/* Index of the entry with the FNV-1a hash @fnv, if it matches @str */
+static int string_matcher_probe(const struct string_matcher *sm, u64 fnv,
+				const char *str)
+{
+	const struct string_matcher_slot *slot;
+	u64 hash = string_matcher_mix(fnv);
+	const char *item;
+
+	slot = &sm->slots[string_matcher_slot(sm, hash,
+			  sm->disp[string_matcher_bucket(sm, hash)])];
+	if (slot->index == STRING_MATCHER_EMPTY || slot->tag != (u32)hash)
+		return -EINVAL;
+
+	item = sm->array[slot->index];
+	if (sm->sysfs ? sysfs_streq(item, str) : !strcmp(item, str))
+		return slot->index;
+	return -EINVAL;
+}
+
+/* The lower of two indices, where -EINVAL is none */
+static inline int string_matcher_first(int a, int b)
+{
+	if (a < 0)
+		return b;
+	if (b < 0)
+		return a;
+	return min(a, b);
+}
+
+/**
+ * string_matcher_match - look a string up in a matcher's table
+ * @sm: the matcher
+ * @str: string to match with
+ *
+ * Returns the index of @str in the table or -%EINVAL, like match_string()
+ * or __sysfs_match_string() would. Costs one pass over @str to hash it
+ * and, unless nothing matches, one string compare.
+ */
+int string_matcher_match(const struct string_matcher *sm, const char *str)
+{
+	size_t len;
+	u64 hash, stem;
+	int ret;
+
+	if (unlikely(!sm->nr_slots))
+		return -EINVAL;
+
+	len = strlen(str);
+	if (!sm->sysfs || !len || str[len - 1] != '\n') {
+		hash = string_matcher_hash(STRING_MATCHER_HASH_INIT, str, len);
+		ret = string_matcher_probe(sm, hash, str);
+		if (!sm->sysfs)
+			return ret;
+
+		/* @str with a newline */
+		hash = string_matcher_hash(hash, "\n", 1);
+		return string_matcher_first(ret,
+				string_matcher_probe(sm, hash, str));
+	}
+
+	/* @str without its newline, as it is and with another one */
+	stem = string_matcher_hash(STRING_MATCHER_HASH_INIT, str, len - 1);
+	ret = string_matcher_probe(sm, stem, str);
+	hash = string_matcher_hash(stem, "\n", 1);
+	ret = string_matcher_first(ret, string_matcher_probe(sm, hash, str));
+	hash = string_matcher_hash(hash, "\n", 1);
+	return string_matcher_first(ret, string_matcher_probe(sm, hash, str));
+}
+EXPORT_SYMBOL(string_matcher_match);
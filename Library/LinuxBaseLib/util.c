@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <LinuxBase.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/export.h>
+
+#include <Uefi.h>
+#include <IndustryStandard/PeImage.h>
+#include <Protocol/LoadedImage.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+/* Read-only sections of the loaded image, found on first use */
+#define IMAGE_RODATA_MAX	8
+
+static struct {
+	unsigned long start;
+	unsigned long end;
+} image_rodata[IMAGE_RODATA_MAX];
+static unsigned int image_rodata_nr;
+static bool image_rodata_done;
+
+/*
+ * Walk the PE/COFF section table of the image this library is linked
+ * into and note every section that is not writable. The EDK2 linker
+ * scripts fold .rodata into .text, so code sections count as well.
+ */
+static void image_rodata_init(void)
+{
+	EFI_LOADED_IMAGE_PROTOCOL *li;
+	EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION hdr;
+	EFI_IMAGE_DOS_HEADER *dos;
+	EFI_IMAGE_SECTION_HEADER *sec;
+	unsigned long base;
+	unsigned int i, nr = 0;
+	EFI_STATUS status;
+
+	status = gBS->HandleProtocol(gImageHandle, &gEfiLoadedImageProtocolGuid,
+				     (VOID **)&li);
+	if (EFI_ERROR(status))
+		goto out;
+
+	base = (unsigned long)li->ImageBase;
+	dos = (EFI_IMAGE_DOS_HEADER *)base;
+	if (dos->e_magic == EFI_IMAGE_DOS_SIGNATURE)
+		hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(base + dos->e_lfanew);
+	else
+		hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)base;
+	if (hdr.Pe32->Signature != EFI_IMAGE_NT_SIGNATURE)
+		goto out;
+
+	sec = (EFI_IMAGE_SECTION_HEADER *)((UINT8 *)&hdr.Pe32->OptionalHeader +
+			hdr.Pe32->FileHeader.SizeOfOptionalHeader);
+	for (i = 0; i < hdr.Pe32->FileHeader.NumberOfSections; i++, sec++) {
+		if (sec->Characteristics & EFI_IMAGE_SCN_MEM_WRITE)
+			continue;
+		if (nr == IMAGE_RODATA_MAX)
+			break;
+		image_rodata[nr].start = base + sec->VirtualAddress;
+		image_rodata[nr].end = base + sec->VirtualAddress +
+				       sec->Misc.VirtualSize;
+		nr++;
+	}
+
+out:
+	image_rodata_nr = nr;
+	image_rodata_done = true;
+}
+
+/*
+ * Whether @addr lies in a read-only section of the image. Above
+ * TPL_NOTIFY the loaded image protocol cannot be asked, until the
+ * sections are known nothing counts as read-only.
+ */
+static bool is_kernel_rodata(unsigned long addr)
+{
+	unsigned int i;
+	EFI_TPL tpl;
+
+	if (unlikely(!READ_ONCE(image_rodata_done))) {
+		tpl = gBS->RaiseTPL(TPL_HIGH_LEVEL);
+		gBS->RestoreTPL(tpl);
+		if (tpl > TPL_NOTIFY)
+			return false;
+		image_rodata_init();
+	}
+
+	for (i = 0; i < image_rodata_nr; i++)
+		if (addr >= image_rodata[i].start && addr < image_rodata[i].end)
+			return true;
+
+	return false;
+}
+
+/**
+ * kfree_const - conditionally free memory
+ * @x: pointer to the memory
+ *
+ * Function calls kfree only if @x is not in .rodata section.
+ */
+void kfree_const(const void *x)
+{
+	if (!is_kernel_rodata((unsigned long)x))
+		kfree(x);
+}
+EXPORT_SYMBOL(kfree_const);
+
+/**
+ * kstrdup - allocate space for and copy an existing string
+ * @s: the string to duplicate
+ * @gfp: the GFP mask used in the kmalloc() call when allocating memory
+ */
+char *kstrdup(const char *s, gfp_t gfp)
+{
+	size_t len;
+	char *buf;
+
+	if (!s)
+		return NULL;
+
+	len = strlen(s) + 1;
+	buf = kmalloc_track_caller(len, gfp);
+	if (buf)
+		memcpy(buf, s, len);
+	return buf;
+}
+EXPORT_SYMBOL(kstrdup);
+
+/**
+ * kstrdup_const - conditionally duplicate an existing const string
+ * @s: the string to duplicate
+ * @gfp: the GFP mask used in the kmalloc() call when allocating memory
+ *
+ * Function returns source string if it is in .rodata section otherwise it
+ * fallbacks to kstrdup.
+ * Strings allocated by kstrdup_const should be freed by kfree_const.
+ */
+const char *kstrdup_const(const char *s, gfp_t gfp)
+{
+	if (is_kernel_rodata((unsigned long)s))
+		return s;
+
+	return kstrdup(s, gfp);
+}
+EXPORT_SYMBOL(kstrdup_const);
+
+/**
+ * kstrndup - allocate space for and copy an existing string
+ * @s: the string to duplicate
+ * @max: read at most @max chars from @s
+ * @gfp: the GFP mask used in the kmalloc() call when allocating memory
+ *
+ * Note: Use kmemdup_nul() instead if the size is known exactly.
+ */
+char *kstrndup(const char *s, size_t max, gfp_t gfp)
+{
+	size_t len;
+	char *buf;
+
+	if (!s)
+		return NULL;
+
+	len = strnlen(s, max);
+	buf = kmalloc_track_caller(len+1, gfp);
+	if (buf) {
+		memcpy(buf, s, len);
+		buf[len] = '\0';
+	}
+	return buf;
+}
+EXPORT_SYMBOL(kstrndup);
+
+/**
+ * kmemdup - duplicate region of memory
+ *
+ * @src: memory region to duplicate
+ * @len: memory region length
+ * @gfp: GFP mask to use
+ */
+void *kmemdup(const void *src, size_t len, gfp_t gfp)
+{
+	void *p;
+
+	p = kmalloc_track_caller(len, gfp);
+	if (p)
+		memcpy(p, src, len);
+	return p;
+}
+EXPORT_SYMBOL(kmemdup);
+
+/**
+ * kmemdup_nul - Create a NUL-terminated string from unterminated data
+ * @s: The data to stringify
+ * @len: The size of the data
+ * @gfp: the GFP mask used in the kmalloc() call when allocating memory
+ */
+char *kmemdup_nul(const char *s, size_t len, gfp_t gfp)
+{
+	char *buf;
+
+	if (!s)
+		return NULL;
+
+	buf = kmalloc_track_caller(len + 1, gfp);
+	if (buf) {
+		memcpy(buf, s, len);
+		buf[len] = '\0';
+	}
+	return buf;
+}
+EXPORT_SYMBOL(kmemdup_nul);
+
+/**
+ * kvmalloc_node - attempt to allocate physically contiguous memory, but upon
+ * failure, fall back to non-contiguous (vmalloc) allocation.
+ * @size: size of the request.
+ * @flags: gfp mask for the allocation - must be compatible (superset) with GFP_KERNEL.
+ * @node: numa node to allocate from
+ *
+ * Everything is physically contiguous here. Requests too big for the
+ * kmalloc caches already get a page run of their own, the same as
+ * vmalloc() would give them, so this is kmalloc_node().
+ *
+ * Any use of gfp flags outside of GFP_KERNEL should be consulted with mm people.
+ */
+void *kvmalloc_node(size_t size, gfp_t flags, int node)
+{
+	return kmalloc_node_track_caller(size, flags, node);
+}
+EXPORT_SYMBOL(kvmalloc_node);
+
+/**
+ * kvfree() - Free memory.
+ * @addr: Pointer to allocated memory.
+ *
+ * kvfree frees memory allocated by any of vmalloc(), kmalloc() or kvmalloc().
+ * It is slightly more efficient to use kfree() or vfree() if you are certain
+ * that you know which one to use.
+ */
+void kvfree(const void *addr)
+{
+	if (is_vmalloc_addr(addr))
+		vfree(addr);
+	else
+		kfree(addr);
+}
+EXPORT_SYMBOL(kvfree);
+
+/**
+ * kvrealloc - reallocate memory
+ * @p: object to reallocate memory for.
+ * @size: the size to reallocate
+ * @flags: the flags for the page level allocator
+ *
+ * A page run is extended in place when the pages behind it are free and
+ * only moved otherwise, so growing a multi-megabyte buffer step by step
+ * mostly avoids copies. If @p is %NULL, kvrealloc() behaves exactly like
+ * kvmalloc(). If @size is 0 and @p is not a %NULL pointer, the object
+ * pointed to is freed.
+ */
+void *kvrealloc(const void *p, size_t size, gfp_t flags)
+{
+	return krealloc(p, size, flags);
+}
+EXPORT_SYMBOL(kvrealloc);
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *  linux/mm/vmalloc.c
+ *
+ *  Copyright (C) 1993  Linus Torvalds
+ *  Support of BIGMEM added by Gerhard Wichert, Siemens AG, July 1999
+ *  SMP-safe vmalloc/vfree/ioremap, Tigran Aivazian <tigran@veritas.com>, May 2000
+ *  Major rework to support vmap/vunmap, Christoph Hellwig, SGI, August 2002
+ *  Numa awareness, Christoph Lameter, SGI, June 2005
+ *
+ * Without paging of our own, vmalloc() areas are the page runs kmalloc.c
+ * uses for large requests. The run is described in a side table, so the
+ * area starts right at a page boundary, and krealloc()/kvrealloc() can
+ * grow it in place.
+ */
+
+#include <LinuxBase.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/export.h>
+#include <linux/bug.h>
+
+#include "slab.h"
+
+bool is_vmalloc_addr(const void *x)
+{
+	return !ZERO_OR_NULL_PTR(x) && kmem_in_page_run(x);
+}
+EXPORT_SYMBOL(is_vmalloc_addr);
+
+static void *__vmalloc_caller(unsigned long size, gfp_t gfp_mask,
+			      unsigned long caller)
+{
+	if (!size)
+		return NULL;
+
+	return kmalloc_large_caller(size, gfp_mask, caller);
+}
+
+/**
+ *	__vmalloc  -  allocate virtually contiguous memory
+ *	@size:		allocation size
+ *	@gfp_mask:	flags for the page level allocator
+ *
+ *	Allocate enough pages to cover @size. The result is always page
+ *	aligned, even for requests kmalloc() would serve from a slab.
+ */
+void *__vmalloc(unsigned long size, gfp_t gfp_mask)
+{
+	return __vmalloc_caller(size, gfp_mask, _RET_IP_);
+}
+EXPORT_SYMBOL(__vmalloc);
+
+/**
+ *	vmalloc  -  allocate virtually contiguous memory
+ *	@size:		allocation size
+ *
+ *	Allocate enough pages to cover @size from the page level
+ *	allocator and return them page aligned.
+ *
+ *	For tight control over page level allocator and protection flags
+ *	use __vmalloc() instead.
+ */
+void *vmalloc(unsigned long size)
+{
+	return __vmalloc_caller(size, GFP_KERNEL, _RET_IP_);
+}
+EXPORT_SYMBOL(vmalloc);
+
+/**
+ *	vzalloc - allocate virtually contiguous memory with zero fill
+ *	@size:	allocation size
+ *
+ *	Allocate enough pages to cover @size from the page level
+ *	allocator and return them page aligned.
+ *	The memory allocated is set to zero.
+ */
+void *vzalloc(unsigned long size)
+{
+	return __vmalloc_caller(size, GFP_KERNEL | __GFP_ZERO, _RET_IP_);
+}
+EXPORT_SYMBOL(vzalloc);
+
+/**
+ *	vmalloc_node  -  allocate memory on a specific node
+ *	@size:		allocation size
+ *	@node:		numa node
+ *
+ *	There is a single node, @node is ignored.
+ */
+void *vmalloc_node(unsigned long size, int node)
+{
+	return __vmalloc_caller(size, GFP_KERNEL, _RET_IP_);
+}
+EXPORT_SYMBOL(vmalloc_node);
+
+/**
+ * vzalloc_node - allocate memory on a specific node with zero fill
+ * @size:	allocation size
+ * @node:	numa node
+ *
+ * There is a single node, @node is ignored.
+ * The memory allocated is set to zero.
+ */
+void *vzalloc_node(unsigned long size, int node)
+{
+	return __vmalloc_caller(size, GFP_KERNEL | __GFP_ZERO, _RET_IP_);
+}
+EXPORT_SYMBOL(vzalloc_node);
+
+/**
+ *	vmalloc_32  -  allocate virtually contiguous memory (32bit addressable)
+ *	@size:		allocation size
+ *
+ *	Allocate enough 32bit PA addressable pages to cover @size from the
+ *	page level allocator and return them page aligned.
+ */
+void *vmalloc_32(unsigned long size)
+{
+	return __vmalloc_caller(size, GFP_KERNEL | GFP_DMA32, _RET_IP_);
+}
+EXPORT_SYMBOL(vmalloc_32);
+
+/**
+ *	vfree  -  release memory allocated by vmalloc()
+ *	@addr:		memory base address
+ *
+ *	Free the virtually continuous memory area starting at @addr, as
+ *	obtained from vmalloc(), vmalloc_32() or __vmalloc(). If @addr is
+ *	NULL, no operation is performed.
+ *
+ *	May be called at any TPL, the pages then go back to the firmware
+ *	later.
+ */
+void vfree(const void *addr)
+{
+	if (!addr)
+		return;
+
+	WARN_ON(!is_vmalloc_addr(addr));
+	kfree(addr);
+}
+EXPORT_SYMBOL(vfree);
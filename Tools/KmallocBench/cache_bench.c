@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * kmem_cache churn benchmark
+ *
+ * For a range of object sizes, fills a cache with a working set of
+ * objects, then frees and reallocates random ones of them. Reports how
+ * many of these free/alloc pairs run per second, and what the allocator
+ * holds per live object: in pages, and in bytes on top of the object
+ * itself. Both are taken once the working set is allocated, and again
+ * after the churn.
+ *
+ * Held memory is the pages taken from the boot services plus what the
+ * pool accounts for AllocatePool() blocks, see host.c.
+ *
+ *   cache-bench [pairs]
+ */
+
+#include <LinuxBase.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/errno.h>
+#include <asm/page.h>
+
+#include "host.h"
+
+#define BENCH_LIVE	4096
+#define BENCH_PAIRS	(1 << 16)
+
+static const unsigned int bench_sizes[] = {
+	16, 32, 64, 128, 256, 512, 1024,
+};
+
+static void *bench_objs[BENCH_LIVE];
+static u32 bench_seed = 1;
+
+static u32 bench_rand(void)
+{
+	bench_seed = bench_seed * 1103515245 + 12345;
+	return bench_seed >> 16;
+}
+
+static unsigned long bench_held(void)
+{
+	return host_pages_held() * PAGE_SIZE + host_pool_bytes_held();
+}
+
+/* Pages per object to four places, and bytes held beyond the object */
+static void bench_print_held(unsigned long held, unsigned int size)
+{
+	unsigned long pages = held * 10000 / PAGE_SIZE / BENCH_LIVE;
+
+	pr_cont("   %9lu.%04lu %6ld", pages / 10000, pages % 10000,
+		(long)(held / BENCH_LIVE) - (long)size);
+}
+
+static int bench_one(unsigned int size, unsigned long pairs)
+{
+	unsigned long held, filled, i, n;
+	struct kmem_cache *c;
+	u64 t;
+
+	held = bench_held();
+	c = kmem_cache_create("bench", size, 0, 0, NULL);
+	if (!c)
+		return -ENOMEM;
+
+	for (i = 0; i < BENCH_LIVE; i++) {
+		bench_objs[i] = kmem_cache_alloc(c, GFP_KERNEL);
+		if (!bench_objs[i])
+			return -ENOMEM;
+	}
+	filled = bench_held() - held;
+
+	t = host_time_ns();
+	for (n = 0; n < pairs; n++) {
+		i = bench_rand() % BENCH_LIVE;
+		kmem_cache_free(c, bench_objs[i]);
+		bench_objs[i] = kmem_cache_alloc(c, GFP_KERNEL);
+		if (!bench_objs[i])
+			return -ENOMEM;
+	}
+	t = host_time_ns() - t;
+
+	pr_info("%6u %13llu", size, t ? pairs * 1000000000ULL / t : 0ULL);
+	bench_print_held(filled, size);
+	bench_print_held(bench_held() - held, size);
+	pr_cont("\n");
+
+	for (i = 0; i < BENCH_LIVE; i++)
+		kmem_cache_free(c, bench_objs[i]);
+	kmem_cache_destroy(c);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long pairs = BENCH_PAIRS;
+	unsigned int i;
+
+	if (argc > 2 || (argc == 2 && kstrtoul(argv[1], 0, &pairs))) {
+		pr_err("usage: %s [pairs]\n", argv[0]);
+		return 2;
+	}
+	if (host_init(1024))
+		return 1;
+	/* Leave the allocator's one-off setup out of the first figures */
+	kfree(kmalloc(1, GFP_KERNEL));
+
+	pr_info("%s: %u live objects, %lu of them freed and reallocated\n",
+		argv[0], BENCH_LIVE, pairs);
+	pr_info("                    ---- filled ----   ---- churned ---\n");
+	pr_info("  size  free+alloc/s   pages/obj  B/obj   pages/obj  B/obj\n");
+
+	for (i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++) {
+		if (bench_one(bench_sizes[i], pairs)) {
+			pr_err("%s: out of memory\n", argv[0]);
+			return 1;
+		}
+	}
+
+	return 0;
+}
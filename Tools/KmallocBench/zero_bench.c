@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * kzalloc() benchmark
+ *
+ * Times kzalloc() against kmalloc() followed by a memset(), for slab
+ * sizes and for page runs, in two cases:
+ *
+ * - fresh: a few MiB of objects are allocated into an empty cache, so
+ *   they are carved from new slabs, which a zeroing request clears
+ *   whole. Only the allocations are timed.
+ * - recycled: with the same amount live, random objects are freed and
+ *   allocated again, which hands out the object just freed. Each
+ *   free/alloc pair is timed.
+ *
+ * Figures are nanoseconds per object. A '!' marks a kzalloc() that
+ * handed out memory that was not zero.
+ *
+ *   zero-bench [rounds]
+ */
+
+#include <LinuxBase.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/errno.h>
+
+#include "host.h"
+
+#define BENCH_BYTES	(4UL << 20)	/* live at a time */
+#define BENCH_MIN_SIZE	32
+#define BENCH_ROUNDS	16
+
+static const unsigned long bench_sizes[] = {
+	32, 256, 2048, 8192,		/* kmalloc slabs */
+	16384, 65536, 262144,		/* page runs */
+};
+
+static void *bench_objs[BENCH_BYTES / BENCH_MIN_SIZE];
+static bool bench_dirty, bench_failed;
+static u32 bench_seed = 1;
+
+static u32 bench_rand(void)
+{
+	bench_seed = bench_seed * 1103515245 + 12345;
+	return bench_seed >> 16;
+}
+
+static void *bench_alloc(unsigned long size, bool zalloc)
+{
+	u8 *p;
+
+	if (!zalloc) {
+		p = kmalloc(size, GFP_KERNEL);
+		if (p)
+			memset(p, 0, size);
+	} else {
+		p = kzalloc(size, GFP_KERNEL);
+		if (p && (p[0] || p[size - 1]))
+			bench_dirty = true;
+	}
+
+	if (!p)
+		bench_failed = true;
+	return p;
+}
+
+static void bench_free_all(unsigned long nr)
+{
+	unsigned long i;
+
+	for (i = 0; i < nr; i++)
+		kfree(bench_objs[i]);
+}
+
+/* Allocate @nr objects @rounds times over, freeing them in between */
+static u64 bench_fresh(unsigned long size, unsigned long nr,
+		       unsigned long rounds, bool zalloc)
+{
+	unsigned long i, r;
+	u64 t, total = 0;
+
+	for (r = 0; r < rounds; r++) {
+		t = host_time_ns();
+		for (i = 0; i < nr; i++)
+			bench_objs[i] = bench_alloc(size, zalloc);
+		total += host_time_ns() - t;
+
+		bench_free_all(nr);
+	}
+
+	return total;
+}
+
+/* With @nr objects live, free and reallocate @pairs random ones */
+static u64 bench_recycled(unsigned long size, unsigned long nr,
+			  unsigned long pairs, bool zalloc)
+{
+	unsigned long i, n;
+	u64 t;
+
+	for (i = 0; i < nr; i++)
+		bench_objs[i] = bench_alloc(size, false);
+
+	t = host_time_ns();
+	for (n = 0; n < pairs; n++) {
+		i = bench_rand() % nr;
+		kfree(bench_objs[i]);
+		bench_objs[i] = bench_alloc(size, zalloc);
+	}
+	t = host_time_ns() - t;
+
+	bench_free_all(nr);
+
+	return t;
+}
+
+/* Nanoseconds per object to one place */
+static void bench_print(u64 ns, unsigned long nr)
+{
+	u64 tenths = ns * 10 / nr;
+
+	pr_cont(" %13llu.%llu", tenths / 10, tenths % 10);
+}
+
+static int bench_one(unsigned long size, unsigned long rounds)
+{
+	unsigned long nr = BENCH_BYTES / size;
+	u64 fresh_kz, fresh_km, recycled_kz, recycled_km;
+
+	bench_dirty = false;
+	fresh_kz = bench_fresh(size, nr, rounds, true);
+	fresh_km = bench_fresh(size, nr, rounds, false);
+	recycled_kz = bench_recycled(size, nr, nr * rounds, true);
+	recycled_km = bench_recycled(size, nr, nr * rounds, false);
+
+	if (bench_failed)
+		return -ENOMEM;
+
+	pr_info("%7lu", size);
+	bench_print(fresh_kz, nr * rounds);
+	bench_print(fresh_km, nr * rounds);
+	bench_print(recycled_kz, nr * rounds);
+	bench_print(recycled_km, nr * rounds);
+	pr_cont("%s\n", bench_dirty ? " !" : "");
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long rounds = BENCH_ROUNDS;
+	unsigned int i;
+
+	if (argc > 2 || (argc == 2 && (kstrtoul(argv[1], 0, &rounds) ||
+				       !rounds))) {
+		pr_err("usage: %s [rounds]\n", argv[0]);
+		return 2;
+	}
+	if (host_init(1024))
+		return 1;
+	/* Leave the allocator's one-off setup out of the first figures */
+	kfree(kmalloc(1, GFP_KERNEL));
+
+	pr_info("%s: %lu KiB live, allocated %lu times over, ns per object\n",
+		argv[0], BENCH_BYTES >> 10, rounds);
+	pr_info("         ------------ fresh ------------  ----------- recycled ----------\n");
+	pr_info("   size          kzalloc  kmalloc+memset          kzalloc  kmalloc+memset\n");
+
+	for (i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++) {
+		if (bench_one(bench_sizes[i], rounds)) {
+			pr_err("%s: out of memory\n", argv[0]);
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,17 @@
+/*
+ * Stands in for the AutoGen.h the EDK2 build force-includes into every
+ * module, with just what LinuxBaseLib needs when built for the host.
+ */
+#ifndef __KMALLOC_REPLAY_AUTOGEN_H
+#define __KMALLOC_REPLAY_AUTOGEN_H
+
+#define CONFIG_64BIT	1
+
+/* From MdePkg's Base.h, IncludeUefi/stdarg.h maps the C ones onto them */
+typedef __builtin_va_list	VA_LIST;
+#define VA_START(a, b)		__builtin_va_start(a, b)
+#define VA_END(a)		__builtin_va_end(a)
+#define VA_ARG(a, t)		__builtin_va_arg(a, t)
+#define VA_COPY(d, s)		__builtin_va_copy(d, s)
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __KMALLOC_REPLAY_MEMORY_ALLOCATION_LIB_H
+#define __KMALLOC_REPLAY_MEMORY_ALLOCATION_LIB_H
+
+VOID *EFIAPI AllocatePages(IN UINTN Pages);
+VOID *EFIAPI AllocateAlignedPages(IN UINTN Pages, IN UINTN Alignment);
+VOID EFIAPI FreePages(IN VOID *Buffer, IN UINTN Pages);
+VOID EFIAPI FreeAlignedPages(IN VOID *Buffer, IN UINTN Pages);
+VOID *EFIAPI AllocatePool(IN UINTN AllocationSize);
+VOID EFIAPI FreePool(IN VOID *Buffer);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef __KMALLOC_REPLAY_TIMER_LIB_H
+#define __KMALLOC_REPLAY_TIMER_LIB_H
+
+UINT64 EFIAPI GetPerformanceCounter(VOID);
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Only the boot services kmalloc.c calls. host.c backs them with a
+ * page allocator of its own.
+ */
+#ifndef __KMALLOC_REPLAY_UEFI_BOOT_SERVICES_TABLE_LIB_H
+#define __KMALLOC_REPLAY_UEFI_BOOT_SERVICES_TABLE_LIB_H
+
+#define TPL_APPLICATION		4
+#define TPL_CALLBACK		8
+#define TPL_NOTIFY		16
+#define TPL_HIGH_LEVEL		31
+
+typedef enum {
+	AllocateAnyPages,
+	AllocateMaxAddress,
+	AllocateAddress,
+	MaxAllocateType
+} EFI_ALLOCATE_TYPE;
+
+typedef enum {
+	EfiReservedMemoryType,
+	EfiLoaderCode,
+	EfiLoaderData,
+	EfiBootServicesCode,
+	EfiBootServicesData,
+} EFI_MEMORY_TYPE;
+
+typedef EFI_TPL (EFIAPI *EFI_RAISE_TPL)(IN EFI_TPL NewTpl);
+typedef VOID (EFIAPI *EFI_RESTORE_TPL)(IN EFI_TPL OldTpl);
+typedef EFI_STATUS (EFIAPI *EFI_ALLOCATE_PAGES)(IN EFI_ALLOCATE_TYPE Type,
+		IN EFI_MEMORY_TYPE MemoryType, IN UINTN Pages,
+		IN OUT EFI_PHYSICAL_ADDRESS *Memory);
+typedef EFI_STATUS (EFIAPI *EFI_FREE_PAGES)(IN EFI_PHYSICAL_ADDRESS Memory,
+		IN UINTN Pages);
+
+typedef struct {
+	EFI_RAISE_TPL		RaiseTPL;
+	EFI_RESTORE_TPL		RestoreTPL;
+	EFI_ALLOCATE_PAGES	AllocatePages;
+	EFI_FREE_PAGES		FreePages;
+} EFI_BOOT_SERVICES;
+
+extern EFI_BOOT_SERVICES *gBS;
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * The subset of the UEFI base types and macros LinuxBaseLib uses, so that
+ * it can be built for the host without MdePkg.
+ */
+#ifndef __KMALLOC_REPLAY_UEFI_H
+#define __KMALLOC_REPLAY_UEFI_H
+
+#define EFIAPI
+#define IN
+#define OUT
+#define VOID	void
+
+#define TRUE	1
+#define FALSE	0
+
+typedef unsigned long		UINTN;
+typedef long			INTN;
+typedef unsigned long long	UINT64;
+typedef unsigned int		UINT32;
+typedef unsigned char		BOOLEAN;
+
+typedef UINTN			EFI_STATUS;
+typedef UINT64			EFI_PHYSICAL_ADDRESS;
+typedef UINTN			EFI_TPL;
+
+#define MAX_BIT			(1UL << (sizeof(UINTN) * 8 - 1))
+#define ENCODE_ERROR(e)		((EFI_STATUS)(MAX_BIT | (e)))
+
+#define EFI_SUCCESS		0
+#define EFI_INVALID_PARAMETER	ENCODE_ERROR(2)
+#define EFI_OUT_OF_RESOURCES	ENCODE_ERROR(9)
+#define EFI_NOT_FOUND		ENCODE_ERROR(14)
+
+#define EFI_ERROR(s)		((INTN)(EFI_STATUS)(s) < 0)
+
+#define EFI_PAGE_SIZE		0x1000
+#define EFI_PAGE_MASK		0xFFF
+#define EFI_PAGE_SHIFT		12
+
+#define EFI_SIZE_TO_PAGES(s)	(((s) >> EFI_PAGE_SHIFT) + \
+				 (((s) & EFI_PAGE_MASK) ? 1 : 0))
+#define EFI_PAGES_TO_SIZE(p)	((UINTN)(p) << EFI_PAGE_SHIFT)
+
+#define SIGNATURE_16(A, B)	((A) | (B << 8))
+#define SIGNATURE_32(A, B, C, D) \
+	(SIGNATURE_16(A, B) | (SIGNATURE_16(C, D) << 16))
+
+#define BASE_CR(Record, TYPE, Field) \
+	((TYPE *)((char *)(Record) - (char *)&(((TYPE *)0)->Field)))
+#define ALIGN_VALUE(Value, Alignment) \
+	((Value) + (((Alignment) - (Value)) & ((Alignment) - 1)))
+
+#endif
@@ -0,0 +1,375 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * The firmware underneath LinuxBaseLib, for running it on the build host
+ *
+ * The boot services side is modelled after the EDK2 one: pages come top
+ * down, first fit, from an identity mapped arena, AllocateMaxAddress
+ * requests from a second one below 4 GiB. The TPL is only tracked so
+ * that page calls made with the allocator lock held are caught.
+ *
+ * Shared by the tools under Tools/, which see it through host.h.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <Uefi.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "host.h"
+
+#define HOST_LOW_PAGES	(64UL << (20 - EFI_PAGE_SHIFT))
+
+struct arena {
+	uintptr_t base;
+	unsigned long nr_pages;
+	unsigned char *used;
+};
+
+static struct arena host_high, host_low;
+static unsigned long host_pages, host_pool_bytes, host_calls;
+static EFI_TPL host_tpl = TPL_APPLICATION;
+
+static int arena_init(struct arena *a, unsigned long nr_pages, int flags)
+{
+	void *base;
+
+	base = mmap(NULL, EFI_PAGES_TO_SIZE(nr_pages), PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | flags, -1, 0);
+	if (base == MAP_FAILED)
+		return -errno;
+
+	a->used = calloc(nr_pages, 1);
+	if (!a->used) {
+		munmap(base, EFI_PAGES_TO_SIZE(nr_pages));
+		return -ENOMEM;
+	}
+	a->base = (uintptr_t)base;
+	a->nr_pages = nr_pages;
+
+	return 0;
+}
+
+static struct arena *arena_of(uintptr_t addr)
+{
+	if (addr - host_high.base < EFI_PAGES_TO_SIZE(host_high.nr_pages))
+		return &host_high;
+	if (addr - host_low.base < EFI_PAGES_TO_SIZE(host_low.nr_pages))
+		return &host_low;
+	return NULL;
+}
+
+static void arena_take(struct arena *a, unsigned long i, unsigned long nr)
+{
+	memset(a->used + i, 1, nr);
+	host_pages += nr;
+	/* Fresh pages are not zeroed by the firmware either */
+	memset((void *)(a->base + EFI_PAGES_TO_SIZE(i)), 0xa5,
+	       EFI_PAGES_TO_SIZE(nr));
+}
+
+static void *arena_alloc(struct arena *a, unsigned long nr,
+			 unsigned long align, uintptr_t max)
+{
+	unsigned long step = align > EFI_PAGE_SIZE ? align >> EFI_PAGE_SHIFT : 1;
+	unsigned long i, j;
+	uintptr_t addr;
+
+	if (!nr || nr > a->nr_pages)
+		return NULL;
+
+	for (i = a->nr_pages - nr + 1; i-- > 0; ) {
+		addr = a->base + EFI_PAGES_TO_SIZE(i);
+		if ((addr >> EFI_PAGE_SHIFT) % step ||
+		    addr + EFI_PAGES_TO_SIZE(nr) - 1 > max)
+			continue;
+
+		for (j = nr; j > 0; j--)
+			if (a->used[i + j - 1])
+				break;
+		if (!j) {
+			arena_take(a, i, nr);
+			return (void *)addr;
+		}
+
+		/* Carry on with the highest run that ends below the used page */
+		if (i + j - 1 < nr)
+			return NULL;
+		i = i + j - nr;
+	}
+
+	return NULL;
+}
+
+static void host_check_tpl(const char *what)
+{
+	if (host_tpl > TPL_NOTIFY) {
+		fprintf(stderr, "%s at TPL %lu\n", what, host_tpl);
+		abort();
+	}
+}
+
+static EFI_STATUS EFIAPI host_AllocatePages(EFI_ALLOCATE_TYPE Type,
+					    EFI_MEMORY_TYPE MemoryType,
+					    UINTN Pages,
+					    EFI_PHYSICAL_ADDRESS *Memory)
+{
+	struct arena *a;
+	unsigned long i, j;
+	void *p;
+
+	host_check_tpl("AllocatePages()");
+	host_calls++;
+
+	switch (Type) {
+	case AllocateAnyPages:
+		p = arena_alloc(&host_high, Pages, EFI_PAGE_SIZE, UINTPTR_MAX);
+		break;
+	case AllocateMaxAddress:
+		p = arena_alloc(&host_low, Pages, EFI_PAGE_SIZE, *Memory);
+		break;
+	case AllocateAddress:
+		a = arena_of(*Memory);
+		if (!a || *Memory & EFI_PAGE_MASK)
+			return EFI_NOT_FOUND;
+		i = (*Memory - a->base) >> EFI_PAGE_SHIFT;
+		if (Pages > a->nr_pages - i)
+			return EFI_NOT_FOUND;
+		for (j = 0; j < Pages; j++)
+			if (a->used[i + j])
+				return EFI_NOT_FOUND;
+		arena_take(a, i, Pages);
+		return EFI_SUCCESS;
+	default:
+		return EFI_INVALID_PARAMETER;
+	}
+
+	if (!p)
+		return EFI_OUT_OF_RESOURCES;
+	*Memory = (uintptr_t)p;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_FreePages(EFI_PHYSICAL_ADDRESS Memory,
+					UINTN Pages)
+{
+	struct arena *a = arena_of(Memory);
+	unsigned long i, j;
+
+	host_check_tpl("FreePages()");
+	host_calls++;
+
+	if (!a || Memory & EFI_PAGE_MASK)
+		return EFI_NOT_FOUND;
+	i = (Memory - a->base) >> EFI_PAGE_SHIFT;
+	if (Pages > a->nr_pages - i)
+		return EFI_NOT_FOUND;
+	for (j = 0; j < Pages; j++)
+		if (!a->used[i + j])
+			return EFI_NOT_FOUND;
+
+	memset(a->used + i, 0, Pages);
+	host_pages -= Pages;
+	return EFI_SUCCESS;
+}
+
+static EFI_TPL EFIAPI host_RaiseTPL(EFI_TPL NewTpl)
+{
+	EFI_TPL old = host_tpl;
+
+	host_tpl = NewTpl;
+	return old;
+}
+
+static VOID EFIAPI host_RestoreTPL(EFI_TPL OldTpl)
+{
+	host_tpl = OldTpl;
+}
+
+static EFI_BOOT_SERVICES host_boot_services = {
+	.RaiseTPL	= host_RaiseTPL,
+	.RestoreTPL	= host_RestoreTPL,
+	.AllocatePages	= host_AllocatePages,
+	.FreePages	= host_FreePages,
+};
+
+EFI_BOOT_SERVICES *gBS = &host_boot_services;
+
+VOID *EFIAPI AllocateAlignedPages(UINTN Pages, UINTN Alignment)
+{
+	host_check_tpl("AllocateAlignedPages()");
+	host_calls++;
+	return arena_alloc(&host_high, Pages, Alignment, UINTPTR_MAX);
+}
+
+VOID *EFIAPI AllocatePages(UINTN Pages)
+{
+	return AllocateAlignedPages(Pages, EFI_PAGE_SIZE);
+}
+
+VOID EFIAPI FreePages(VOID *Buffer, UINTN Pages)
+{
+	if (EFI_ERROR(host_FreePages((uintptr_t)Buffer, Pages))) {
+		fprintf(stderr, "FreePages(%p, %lu) of pages not allocated\n",
+			Buffer, Pages);
+		abort();
+	}
+}
+
+VOID EFIAPI FreeAlignedPages(VOID *Buffer, UINTN Pages)
+{
+	FreePages(Buffer, Pages);
+}
+
+/*
+ * Only the accounting of AllocatePool() follows the DXE core pool: the
+ * request grows by the pool's 40 byte head and tail and is rounded up to
+ * its size classes, or to whole pages above 2688 bytes. The memory comes
+ * from malloc(), with the accounted size in front of it.
+ */
+#define HOST_POOL_OVERHEAD	40
+#define HOST_POOL_HEAD		16
+
+static const unsigned short host_pool_sizes[] = {
+	128, 256, 384, 640, 1024, 1664, 2688,
+};
+
+VOID *EFIAPI AllocatePool(UINTN AllocationSize)
+{
+	UINTN size = ((AllocationSize + 7) & ~7UL) + HOST_POOL_OVERHEAD;
+	unsigned int i, n = sizeof(host_pool_sizes) / sizeof(host_pool_sizes[0]);
+	char *p;
+
+	for (i = 0; i < n; i++)
+		if (size <= host_pool_sizes[i])
+			break;
+	if (i < n)
+		size = host_pool_sizes[i];
+	else
+		size = EFI_PAGES_TO_SIZE(EFI_SIZE_TO_PAGES(size));
+
+	p = malloc(HOST_POOL_HEAD + AllocationSize);
+	if (!p)
+		return NULL;
+	*(UINTN *)p = size;
+	host_pool_bytes += size;
+
+	return p + HOST_POOL_HEAD;
+}
+
+VOID EFIAPI FreePool(VOID *Buffer)
+{
+	char *p = (char *)Buffer - HOST_POOL_HEAD;
+
+	host_pool_bytes -= *(UINTN *)p;
+	free(p);
+}
+
+UINT64 EFIAPI GetPerformanceCounter(VOID)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* What LinuxBaseLib otherwise gets from printk.c, panic.c and util.c */
+static void host_vprintk(const char *fmt, va_list args)
+{
+	/* Drop the KERN_<LEVEL> prefixes */
+	while (fmt[0] == '\001' && fmt[1])
+		fmt += 2;
+	vfprintf(stdout, fmt, args);
+}
+
+int printk(const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	host_vprintk(fmt, args);
+	va_end(args);
+	return 0;
+}
+
+void panic(const char *fmt, ...)
+{
+	va_list args;
+
+	fputs("panic: ", stderr);
+	va_start(args, fmt);
+	host_vprintk(fmt, args);
+	va_end(args);
+	abort();
+}
+
+void warn_slowpath_null(const char *file, const int line)
+{
+	fprintf(stderr, "WARNING: at %s:%d\n", file, line);
+}
+
+/*
+ * The one in util.c needs the loaded image protocol to tell string
+ * literals apart, the tools only ever pass literals.
+ */
+const char *kstrdup_const(const char *s, unsigned int gfp)
+{
+	return s;
+}
+
+void kfree_const(const void *x)
+{
+}
+
+int host_init(unsigned long arena_mib)
+{
+	if (arena_init(&host_high, arena_mib << (20 - EFI_PAGE_SHIFT), 0)) {
+		perror("page arena");
+		return -1;
+	}
+	/* Without it the GFP_DMA32 allocations fail, but the rest can run */
+	if (arena_init(&host_low, HOST_LOW_PAGES, MAP_32BIT))
+		fprintf(stderr, "warning: no page arena below 4 GiB\n");
+
+	return 0;
+}
+
+void *host_zalloc(unsigned long size)
+{
+	return calloc(1, size);
+}
+
+void host_free(void *p)
+{
+	free(p);
+}
+
+unsigned long host_pages_held(void)
+{
+	return host_pages;
+}
+
+unsigned long host_pool_bytes_held(void)
+{
+	return host_pool_bytes;
+}
+
+unsigned long host_page_calls(void)
+{
+	return host_calls;
+}
+
+unsigned long long host_time_ns(void)
+{
+	return GetPerformanceCounter();
+}
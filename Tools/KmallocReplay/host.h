@@ -0,0 +1,27 @@
+/*
+ * What host.c offers on top of the boot services, to code built against
+ * the C library and the LinuxBaseLib headers alike. Only plain C types
+ * cross it.
+ */
+#ifndef __KMALLOC_REPLAY_HOST_H
+#define __KMALLOC_REPLAY_HOST_H
+
+#define HOST_PAGE_SHIFT		12
+
+/* Set up the page arenas, @arena_mib is the size of the main one */
+int host_init(unsigned long arena_mib);
+
+/* Memory for the tools themselves, not accounted anywhere */
+void *host_zalloc(unsigned long size);
+void host_free(void *p);
+
+/* Pages taken from the boot services and not yet given back */
+unsigned long host_pages_held(void);
+/* Bytes the pool accounts for live AllocatePool() blocks */
+unsigned long host_pool_bytes_held(void);
+/* Calls into the page allocator so far */
+unsigned long host_page_calls(void);
+
+unsigned long long host_time_ns(void);
+
+#endif
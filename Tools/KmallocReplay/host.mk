@@ -0,0 +1,73 @@
+# Building LinuxBaseLib for the build host, shared by the tools under Tools/
+#
+# A tool sets LIB_OBJS to the library objects it needs and includes this
+# file. Its own sources built against the library headers go to obj/new/
+# along with the library, those built against the C library to obj/.
+#
+# obj/base/ holds the same objects built from the package as it was at
+# BASE_REV, by default as imported, to compare against. Run make clean
+# after changing BASE_REV.
+
+HOST_DIR := $(patsubst %/,%,$(dir $(lastword $(MAKEFILE_LIST))))
+PKG	?= $(HOST_DIR)/../..
+LIB	?= $(PKG)/Library/LinuxBaseLib
+
+BASE_REV ?= 7c5fa29
+BASE_PKG := obj/base-src
+BASE_LIB := $(BASE_PKG)/Library/LinuxBaseLib
+
+CFLAGS	?= -O2 -g
+CFLAGS	+= -Wall $(EXTRA_CFLAGS)
+
+# Library sources see the package headers only, the way the EDK2 build
+# compiles them: $(1) is the package, $(2) the library directory
+lib_cflags = -nostdinc -ffreestanding -fno-builtin -fno-strict-aliasing \
+	-ffunction-sections -fdata-sections \
+	-Wno-unused-function -Wno-pointer-arith -Wno-sign-compare \
+	-include $(HOST_DIR)/Include/AutoGen.h -I$(HOST_DIR)/Include \
+	-I$(2) -I$(HOST_DIR) \
+	-I$(1)/IncludeArch -I$(1)/IncludeArchGenerated \
+	-I$(1)/IncludeGeneric -I$(1)/IncludeUefi \
+	-I$(1)/IncludeArch/uapi -I$(1)/IncludeArchGenerated/uapi \
+	-I$(1)/IncludeGeneric/uapi
+
+HOST_CFLAGS := -I$(HOST_DIR)/Include -I$(HOST_DIR)
+NEW_CFLAGS := $(call lib_cflags,$(PKG),$(LIB))
+BASE_CFLAGS := $(call lib_cflags,$(BASE_PKG),$(BASE_LIB))
+
+NEW_LIB_OBJS := $(addprefix obj/new/,$(LIB_OBJS))
+BASE_LIB_OBJS := $(addprefix obj/base/,$(LIB_OBJS))
+
+# Only what the tool calls is kept, printk() and panic() come from host.c
+LDFLAGS	+= -Wl,--gc-sections
+
+obj/host.o: $(HOST_DIR)/host.c $(HOST_DIR)/host.h \
+	    $(wildcard $(HOST_DIR)/Include/*.h $(HOST_DIR)/Include/*/*.h) | obj
+	$(CC) $(CFLAGS) $(HOST_CFLAGS) -c -o $@ $<
+
+obj/%.o: %.c | obj
+	$(CC) $(CFLAGS) $(HOST_CFLAGS) -c -o $@ $<
+
+obj/new/%.o: $(LIB)/%.c | obj/new
+	$(CC) $(CFLAGS) $(NEW_CFLAGS) -c -o $@ $<
+
+obj/new/%.o: %.c | obj/new
+	$(CC) $(CFLAGS) $(NEW_CFLAGS) -c -o $@ $<
+
+obj/base/%.o: %.c $(BASE_PKG)/.stamp | obj/base
+	$(CC) $(CFLAGS) $(BASE_CFLAGS) -c -o $@ $<
+
+$(BASE_LIB_OBJS): obj/base/%.o: $(BASE_PKG)/.stamp | obj/base
+	$(CC) $(CFLAGS) $(BASE_CFLAGS) -c -o $@ $(BASE_LIB)/$*.c
+
+$(BASE_PKG)/.stamp:
+	rm -rf $(BASE_PKG) && mkdir -p $(BASE_PKG)
+	git -C $(PKG) archive $(BASE_REV) IncludeArch IncludeArchGenerated \
+		IncludeGeneric IncludeUefi Library/LinuxBaseLib | \
+		tar -x -C $(BASE_PKG)
+	touch $@
+
+obj obj/new obj/base:
+	mkdir -p $@
+
+.SECONDARY:
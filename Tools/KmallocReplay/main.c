@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * kmalloc-replay: replays kmalloc traces on the build host
+ *
+ * Runs kmalloc.c as it is on top of host.c, and reports how fast the
+ * trace replays, how many pages the allocator held at most and how much
+ * of them went unused.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host.h"
+#include "replay.h"
+
+static void *read_trace(const char *path, unsigned long *nr)
+{
+	FILE *f;
+	long size;
+	void *buf;
+
+	f = fopen(path, "rb");
+	if (!f)
+		goto err;
+	if (fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET))
+		goto err_close;
+	if (size % REPLAY_EVENT_SIZE) {
+		fprintf(stderr, "%s: not a whole number of %d byte events\n",
+			path, REPLAY_EVENT_SIZE);
+		fclose(f);
+		return NULL;
+	}
+
+	buf = malloc(size ? size : 1);
+	if (!buf)
+		goto err_close;
+	if (fread(buf, 1, size, f) != (size_t)size) {
+		free(buf);
+		goto err_close;
+	}
+	fclose(f);
+
+	*nr = size / REPLAY_EVENT_SIZE;
+	return buf;
+
+err_close:
+	fclose(f);
+err:
+	perror(path);
+	return NULL;
+}
+
+static double frag(unsigned long live_bytes, unsigned long pages)
+{
+	if (!pages)
+		return 0;
+	return 100.0 * (1.0 - (double)live_bytes / (pages << HOST_PAGE_SHIFT));
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-m MiB] [-r runs] trace\n"
+		"\n"
+		"Replays a kmalloc_trace_snapshot() dump against kmalloc.c.\n"
+		"  -m MiB   size of the page arena (default 1024)\n"
+		"  -r runs  replay the trace this many times for the timing,\n"
+		"           the footprint is that of the first run (default 1)\n",
+		prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	struct replay_stats st, first = { 0 };
+	unsigned long arena_mib = 1024, runs = 1, nr, run, calls;
+	struct timespec t0, t1;
+	const char *path;
+	double secs;
+	void *events;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:r:")) != -1) {
+		switch (opt) {
+		case 'm':
+			arena_mib = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			runs = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || !arena_mib || !runs)
+		usage(argv[0]);
+	path = argv[optind];
+
+	events = read_trace(path, &nr);
+	if (!events)
+		return 1;
+
+	if (host_init(arena_mib))
+		return 1;
+
+	calls = host_page_calls();
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (run = 0; run < runs; run++) {
+		if (replay_run(events, nr, &st)) {
+			fprintf(stderr, "%s: out of memory\n", path);
+			return 1;
+		}
+		if (!run) {
+			first = st;
+			calls = host_page_calls() - calls;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	printf("%s: %lu events over %llu ticks\n", path, first.events,
+	       first.ticks);
+	printf("  replayed       %lu calls, %lu skipped, %lu failed, "
+	       "%lu caches\n", first.replayed, first.skipped, first.failed,
+	       first.caches);
+	printf("  throughput     %.0f calls/s (%.3f ms for %lu run%s)\n",
+	       secs > 0 ? first.replayed * runs / secs : 0.0, secs * 1e3,
+	       runs, runs == 1 ? "" : "s");
+	printf("  peak footprint %lu pages (%lu KiB), %lu page calls\n",
+	       first.peak_pages, (first.peak_pages << HOST_PAGE_SHIFT) >> 10,
+	       calls);
+	printf("  peak live      %lu bytes\n", first.peak_live_bytes);
+	printf("  fragmentation  %.1f%% at peak footprint (%lu bytes live)\n",
+	       frag(first.peak_pages_live_bytes, first.peak_pages),
+	       first.peak_pages_live_bytes);
+	printf("                 %.1f%% at the end (%lu pages, %lu bytes live)\n",
+	       frag(first.live_bytes, first.pages), first.pages,
+	       first.live_bytes);
+
+	free(events);
+	return 0;
+}
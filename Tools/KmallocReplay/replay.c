@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Replays a kmalloc trace against kmalloc.c
+ *
+ * The trace is what kmalloc_trace_snapshot() returns in a firmware built
+ * with CONFIG_KMALLOC_TRACE. Every call is issued again in the recorded
+ * order, the pointers it returned are mapped to the ones kmalloc.c hands
+ * out here. Calls that failed when traced are skipped, as are frees and
+ * reallocs of objects allocated before the ring starts.
+ *
+ * This file is built against the LinuxBaseLib headers, main.c against
+ * the C library, replay.h is all they share.
+ */
+
+#include <LinuxBase.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/log2.h>
+#include <linux/bug.h>
+#include <linux/errno.h>
+
+#include "slab.h"
+#include "host.h"
+#include "replay.h"
+
+/* Per-(size, alignment) caches the CACHE_* events are replayed through */
+#define REPLAY_MAX_CACHES	256
+
+struct replay_cache {
+	u32 size;
+	u8 align_order;
+	struct kmem_cache *cache;
+};
+
+struct replay_obj {
+	u64 traced;		/* the pointer in the trace, 0 if the slot is free */
+	void *ptr;		/* the one kmalloc.c returned for it here */
+	u32 size;
+	struct kmem_cache *cache;
+};
+
+struct replay {
+	struct replay_obj *objs;	/* open addressing on the traced pointer */
+	unsigned long mask;
+	struct replay_cache caches[REPLAY_MAX_CACHES];
+	unsigned int nr_caches;
+	struct replay_stats *st;
+};
+
+static unsigned long replay_hash(const struct replay *r, u64 traced)
+{
+	return ((traced >> 4) * 0x9e3779b97f4a7c15ULL >> 32) & r->mask;
+}
+
+static struct replay_obj *replay_find(struct replay *r, u64 traced)
+{
+	unsigned long i = replay_hash(r, traced);
+
+	while (r->objs[i].traced) {
+		if (r->objs[i].traced == traced)
+			return &r->objs[i];
+		i = (i + 1) & r->mask;
+	}
+
+	return NULL;
+}
+
+static void replay_insert(struct replay *r, u64 traced, void *ptr, u32 size,
+			  struct kmem_cache *cache)
+{
+	struct replay_stats *st = r->st;
+	unsigned long i = replay_hash(r, traced);
+
+	while (r->objs[i].traced && r->objs[i].traced != traced)
+		i = (i + 1) & r->mask;
+
+	/* The free of whatever lived here fell outside the trace */
+	if (r->objs[i].traced)
+		st->live_bytes -= r->objs[i].size;
+
+	r->objs[i].traced = traced;
+	r->objs[i].ptr = ptr;
+	r->objs[i].size = size;
+	r->objs[i].cache = cache;
+
+	st->live_bytes += size;
+	st->peak_live_bytes = max(st->peak_live_bytes, st->live_bytes);
+}
+
+/* Linear probing, so the entries after @o move up to keep the chains whole */
+static void replay_remove(struct replay *r, struct replay_obj *o)
+{
+	unsigned long i = o - r->objs, j = i, k;
+
+	r->st->live_bytes -= o->size;
+
+	for (;;) {
+		r->objs[i].traced = 0;
+		do {
+			j = (j + 1) & r->mask;
+			if (!r->objs[j].traced)
+				return;
+			k = replay_hash(r, r->objs[j].traced);
+		} while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
+		r->objs[i] = r->objs[j];
+		i = j;
+	}
+}
+
+static struct kmem_cache *replay_cache(struct replay *r,
+				       const struct kmalloc_trace_event *e)
+{
+	struct replay_cache *rc;
+	unsigned int i;
+
+	for (i = 0; i < r->nr_caches; i++) {
+		rc = &r->caches[i];
+		if (rc->size == e->size && rc->align_order == e->align_order)
+			return rc->cache;
+	}
+
+	if (r->nr_caches == REPLAY_MAX_CACHES)
+		return NULL;
+
+	rc = &r->caches[r->nr_caches];
+	rc->cache = kmem_cache_create("replay", e->size,
+				      e->align_order ? 1UL << e->align_order : 0,
+				      0, NULL);
+	if (!rc->cache)
+		return NULL;
+	rc->size = e->size;
+	rc->align_order = e->align_order;
+	r->nr_caches++;
+
+	return rc->cache;
+}
+
+static void replay_free(struct replay *r, const struct kmalloc_trace_event *e)
+{
+	struct replay_obj *o;
+
+	if (ZERO_OR_NULL_PTR((void *)(unsigned long)e->ptr)) {
+		r->st->replayed++;
+		return;
+	}
+
+	o = replay_find(r, e->ptr);
+	if (!o) {
+		r->st->skipped++;
+		return;
+	}
+
+	if (o->cache)
+		kmem_cache_free(o->cache, o->ptr);
+	else
+		kfree(o->ptr);
+	replay_remove(r, o);
+	r->st->replayed++;
+}
+
+static void replay_alloc(struct replay *r, const struct kmalloc_trace_event *e)
+{
+	struct kmem_cache *cache = NULL;
+	gfp_t flags = (__force gfp_t)e->gfp;
+	void *p;
+
+	if (!e->ptr) {
+		r->st->skipped++;
+		return;
+	}
+
+	if (e->op == KMALLOC_TRACE_CACHE_ALLOC) {
+		cache = replay_cache(r, e);
+		p = cache ? kmem_cache_alloc(cache, flags) :
+			    __kmalloc(e->size, flags);
+	} else if (e->align_order) {
+		p = kmalloc_large_aligned(e->size, flags, 1UL << e->align_order,
+					  _THIS_IP_);
+	} else {
+		p = __kmalloc(e->size, flags);
+	}
+	r->st->replayed++;
+
+	if (ZERO_OR_NULL_PTR(p)) {
+		if (!p)
+			r->st->failed++;
+		return;
+	}
+
+	replay_insert(r, e->ptr, p, e->size, cache);
+}
+
+static void replay_realloc(struct replay *r, const struct kmalloc_trace_event *e)
+{
+	struct replay_obj *o = NULL;
+	gfp_t flags = (__force gfp_t)e->gfp;
+	void *p;
+
+	/* A failed krealloc() left the old object alone */
+	if (!e->ptr) {
+		r->st->skipped++;
+		return;
+	}
+
+	if (!ZERO_OR_NULL_PTR((void *)(unsigned long)e->old)) {
+		o = replay_find(r, e->old);
+		if (!o) {
+			r->st->skipped++;
+			return;
+		}
+	}
+
+	p = krealloc(o ? o->ptr : NULL, e->size, flags);
+	r->st->replayed++;
+
+	if (!p) {
+		r->st->failed++;
+		return;
+	}
+	if (o)
+		replay_remove(r, o);
+	if (!ZERO_OR_NULL_PTR(p))
+		replay_insert(r, e->ptr, p, e->size, NULL);
+}
+
+static void replay_account(struct replay_stats *st)
+{
+	st->pages = host_pages_held();
+	if (st->pages > st->peak_pages) {
+		st->peak_pages = st->pages;
+		st->peak_pages_live_bytes = st->live_bytes;
+	}
+}
+
+/**
+ * replay_run - replay a trace
+ * @events: @nr records as returned by kmalloc_trace_snapshot()
+ * @nr: number of records
+ * @st: filled in with what the replay saw
+ *
+ * Everything still live at the end of the trace is freed again before
+ * returning, after @st has been filled in. Returns 0, or -ENOMEM if
+ * there is no memory to track the objects in.
+ */
+int replay_run(const void *events, unsigned long nr, struct replay_stats *st)
+{
+	const struct kmalloc_trace_event *e = events;
+	struct replay *r;
+	unsigned long i;
+
+	BUILD_BUG_ON(sizeof(*e) != REPLAY_EVENT_SIZE);
+
+	r = host_zalloc(sizeof(*r));
+	if (!r)
+		return -ENOMEM;
+	/* At most one live object per event, at most half full */
+	r->mask = roundup_pow_of_two(max(2 * nr, 16UL)) - 1;
+	r->objs = host_zalloc((r->mask + 1) * sizeof(*r->objs));
+	if (!r->objs) {
+		host_free(r);
+		return -ENOMEM;
+	}
+
+	memset(st, 0, sizeof(*st));
+	r->st = st;
+	st->events = nr;
+	if (nr)
+		st->ticks = (e[nr - 1].timestamp - e[0].timestamp) &
+			    GENMASK_ULL(47, 0);
+	replay_account(st);
+
+	for (i = 0; i < nr; i++, e++) {
+		switch (e->op) {
+		case KMALLOC_TRACE_ALLOC:
+		case KMALLOC_TRACE_CACHE_ALLOC:
+			replay_alloc(r, e);
+			break;
+		case KMALLOC_TRACE_FREE:
+		case KMALLOC_TRACE_CACHE_FREE:
+			replay_free(r, e);
+			break;
+		case KMALLOC_TRACE_REALLOC:
+			replay_realloc(r, e);
+			break;
+		default:
+			st->skipped++;
+			continue;
+		}
+		replay_account(st);
+	}
+	st->caches = r->nr_caches;
+
+	for (i = 0; i <= r->mask; i++) {
+		struct replay_obj *o = &r->objs[i];
+
+		if (!o->traced)
+			continue;
+		if (o->cache)
+			kmem_cache_free(o->cache, o->ptr);
+		else
+			kfree(o->ptr);
+	}
+	for (i = 0; i < r->nr_caches; i++)
+		kmem_cache_destroy(r->caches[i].cache);
+
+	host_free(r->objs);
+	host_free(r);
+
+	return 0;
+}
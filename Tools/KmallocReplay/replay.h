@@ -0,0 +1,28 @@
+/*
+ * Interface between main.c, built against the C library, and replay.c,
+ * built against the LinuxBaseLib headers. Only plain C types cross it.
+ */
+#ifndef __KMALLOC_REPLAY_H
+#define __KMALLOC_REPLAY_H
+
+/* sizeof(struct kmalloc_trace_event), which is what a trace file holds */
+#define REPLAY_EVENT_SIZE	32
+
+struct replay_stats {
+	unsigned long events;		/* records in the trace */
+	unsigned long replayed;		/* calls issued against kmalloc.c */
+	unsigned long skipped;		/* failed when traced, or before it */
+	unsigned long failed;		/* succeeded when traced, not here */
+	unsigned long caches;		/* kmem_caches created for the replay */
+	unsigned long long ticks;	/* timestamp span of the trace */
+
+	unsigned long live_bytes;	/* bytes asked for and not yet freed */
+	unsigned long peak_live_bytes;
+	unsigned long pages;		/* pages taken from the page allocator */
+	unsigned long peak_pages;
+	unsigned long peak_pages_live_bytes; /* live_bytes at peak_pages */
+};
+
+int replay_run(const void *events, unsigned long nr, struct replay_stats *st);
+
+#endif
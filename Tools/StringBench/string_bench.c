@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Substring search benchmark
+ *
+ * Times strstr(), strnstr() and memmem() on the inputs they see in the
+ * firmware: the kernel command line, an initramfs cpio archive and a
+ * property table. It also times them on periodic worst cases, an "aaa..."
+ * haystack against "aa...ab" needles, where comparing the whole needle
+ * at every position costs haystack times needle length.
+ *
+ * Figures are nanoseconds per call, the best of three runs. "at" is
+ * where memmem() found the needle, a '!' marks a strstr() or strnstr()
+ * that disagreed with it.
+ * The cpio archive holds NULs, so only memmem() searches it.
+ *
+ *   string-bench [ms per figure]
+ */
+
+#include <LinuxBase.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+
+#include "host.h"
+
+#define BENCH_MS	20
+#define BENCH_REPEAT	3
+#define BENCH_PERIODIC	(64 << 10)	/* bytes of 'a' */
+#define BENCH_CPIO	(32 << 10)
+
+/*
+ * The baseline has no memmem(), give it the search its strstr() did:
+ * a compare of the whole needle at every position.
+ */
+void *memmem(const void *, size_t, const void *, size_t);
+
+void * __weak memmem(const void *haystack, size_t haystacklen,
+		     const void *needle, size_t needlelen)
+{
+	const char *s = haystack;
+
+	while (haystacklen >= needlelen) {
+		if (!memcmp(s, needle, needlelen))
+			return (void *)s;
+		haystacklen--;
+		s++;
+	}
+	return NULL;
+}
+
+static const char bench_cmdline[] =
+	"console=ttyMSM0,115200,n8 androidboot.console=ttyMSM0 "
+	"androidboot.hardware=qcom user_debug=31 msm_rtb.filter=0x37 "
+	"ehci-hcd.park=3 lpm_levels.sleep_disabled=1 cma=32M@0-0xffffffff "
+	"buildvariant=userdebug androidboot.emmc=true "
+	"androidboot.verifiedbootstate=orange androidboot.veritymode=enforcing "
+	"androidboot.keymaster=1 androidboot.serialno=ZX1G22BXLM "
+	"androidboot.baseband=msm mdss_mdp.panel=1:dsi:0:qcom,mdss_dsi_panel "
+	"androidboot.bootdevice=7824900.sdhci androidboot.mode=normal "
+	"efidroid.multiboot=1";
+
+static const char bench_props[] =
+	"ro.build.id=NJH47F\n"
+	"ro.build.display.id=NJH47F\n"
+	"ro.build.version.incremental=4146041\n"
+	"ro.build.version.sdk=25\n"
+	"ro.build.version.preview_sdk=0\n"
+	"ro.build.version.codename=REL\n"
+	"ro.build.version.all_codenames=REL\n"
+	"ro.build.version.release=7.1.2\n"
+	"ro.build.version.security_patch=2017-08-05\n"
+	"ro.build.version.base_os=\n"
+	"ro.build.date=Tue Jul 11 21:35:38 UTC 2017\n"
+	"ro.build.date.utc=1499808938\n"
+	"ro.build.type=user\n"
+	"ro.build.user=android-build\n"
+	"ro.build.host=wphr1.hot.corp.google.com\n"
+	"ro.build.tags=release-keys\n"
+	"ro.build.flavor=bullhead-user\n"
+	"ro.product.model=Nexus 5X\n"
+	"ro.product.brand=google\n"
+	"ro.product.name=bullhead\n"
+	"ro.product.device=bullhead\n"
+	"ro.product.board=bullhead\n"
+	"ro.product.cpu.abi=arm64-v8a\n"
+	"ro.product.cpu.abilist=arm64-v8a,armeabi-v7a,armeabi\n"
+	"ro.product.cpu.abilist32=armeabi-v7a,armeabi\n"
+	"ro.product.cpu.abilist64=arm64-v8a\n"
+	"ro.product.manufacturer=LGE\n"
+	"ro.product.locale=en-US\n"
+	"ro.wifi.channels=\n"
+	"ro.board.platform=msm8992\n"
+	"ro.build.product=bullhead\n"
+	"ro.build.description=bullhead-user 7.1.2 NJH47F 4146041 release-keys\n"
+	"ro.build.fingerprint=google/bullhead/bullhead:7.1.2/NJH47F/4146041:user/release-keys\n"
+	"ro.build.characteristics=nosdcard\n"
+	"ro.opengles.version=196610\n"
+	"ro.sf.lcd_density=420\n"
+	"persist.hwc.mdpcomp.enable=true\n"
+	"ro.hardware=bullhead\n"
+	"persist.sys.dalvik.vm.lib.2=libart.so\n"
+	"dalvik.vm.isa.arm64.variant=cortex-a53\n"
+	"dalvik.vm.isa.arm64.features=default\n"
+	"net.bt.name=Android\n"
+	"persist.sys.usb.config=mtp,adb\n"
+	"ro.expect.recovery_id=0x2c4a9e18e0c7d1e3f0c9b2a7e7d0a5c5f1e2b3c4\n";
+
+static const char * const bench_cpio_names[] = {
+	"init", "init.rc", "init.environ.rc", "init.usb.rc",
+	"init.bullhead.rc", "ueventd.rc", "ueventd.bullhead.rc",
+	"fstab.bullhead", "default.prop", "sepolicy", "file_contexts.bin",
+	"property_contexts", "seapp_contexts", "service_contexts",
+	"sbin/adbd", "sbin/healthd", "sbin/ueventd", "sbin/watchdogd",
+	"TRAILER!!!",
+};
+
+static char bench_periodic[BENCH_PERIODIC + 1];
+static char bench_needles[3][4096 + 1];
+static char bench_cpio[BENCH_CPIO];
+static size_t bench_cpio_len;
+static unsigned long long bench_target_ns;
+
+static char *bench_put_hex(char *p, u32 v)
+{
+	int i;
+
+	for (i = 28; i >= 0; i -= 4)
+		*p++ = "0123456789abcdef"[(v >> i) & 15];
+	return p;
+}
+
+/* An uncompressed newc archive, the files hold '#' filler */
+static void bench_make_cpio(void)
+{
+	char *p = bench_cpio;
+	u32 fields[13];
+	unsigned int nr = sizeof(bench_cpio_names) / sizeof(bench_cpio_names[0]);
+	unsigned int i, f;
+	size_t name, data;
+
+	for (i = 0; i < nr; i++) {
+		name = strlen(bench_cpio_names[i]) + 1;
+		data = i + 1 < nr ? 128 + 96 * i : 0;
+
+		memset(fields, 0, sizeof(fields));
+		fields[0] = 300 + i;		/* ino */
+		fields[1] = data ? 0100644 : 0;	/* mode */
+		fields[4] = 1;			/* nlink */
+		fields[5] = 1499808938;		/* mtime */
+		fields[6] = data;		/* filesize */
+		fields[11] = name;		/* namesize */
+
+		memcpy(p, "070701", 6);
+		p += 6;
+		for (f = 0; f < 13; f++)
+			p = bench_put_hex(p, fields[f]);
+		memcpy(p, bench_cpio_names[i], name);
+		p += name;
+		while ((p - bench_cpio) & 3)
+			*p++ = 0;
+
+		memset(p, '#', data);
+		p += data;
+		while ((p - bench_cpio) & 3)
+			*p++ = 0;
+	}
+	bench_cpio_len = p - bench_cpio;
+}
+
+struct bench_input {
+	const char *name;
+	const char *hay;	/* NUL terminated unless @binary */
+	size_t len;
+	const char *needle;
+	bool binary;
+};
+
+enum { BENCH_STRSTR, BENCH_STRNSTR, BENCH_MEMMEM };
+
+static const char *bench_call(const struct bench_input *in, int fn)
+{
+	switch (fn) {
+	case BENCH_STRSTR:
+		return strstr(in->hay, in->needle);
+	case BENCH_STRNSTR:
+		return strnstr(in->hay, in->needle, in->len);
+	default:
+		return memmem(in->hay, in->len, in->needle, strlen(in->needle));
+	}
+}
+
+static u64 bench_batch(const struct bench_input *in, int fn, unsigned long n,
+		       const char **found)
+{
+	unsigned long i;
+	u64 t;
+
+	t = host_time_ns();
+	for (i = 0; i < n; i++)
+		*found = bench_call(in, fn);
+	return host_time_ns() - t;
+}
+
+/*
+ * Nanoseconds per call, to one place. The number of calls doubles until
+ * they take the target time, the best of a few such batches counts.
+ * Returns the last result in @found.
+ */
+static u64 bench_time(const struct bench_input *in, int fn, const char **found)
+{
+	unsigned long n = 1;
+	unsigned int r;
+	u64 t, best;
+
+	while ((best = bench_batch(in, fn, n, found)) < bench_target_ns)
+		n *= 2;
+	for (r = 1; r < BENCH_REPEAT; r++) {
+		t = bench_batch(in, fn, n, found);
+		best = min(best, t);
+	}
+
+	return best * 10 / n;
+}
+
+static void bench_one(const struct bench_input *in)
+{
+	const char *found, *expect;
+	u64 tenths[3];
+	bool bad = false;
+	int fn;
+
+	tenths[BENCH_MEMMEM] = bench_time(in, BENCH_MEMMEM, &expect);
+	for (fn = BENCH_STRSTR; !in->binary && fn < BENCH_MEMMEM; fn++) {
+		tenths[fn] = bench_time(in, fn, &found);
+		if (found != expect)
+			bad = true;
+	}
+
+	pr_info("%-18s %6zu %6zu", in->name, in->len, strlen(in->needle));
+	if (expect)
+		pr_cont(" %6td", expect - in->hay);
+	else
+		pr_cont(" %6s", "-");
+	for (fn = BENCH_STRSTR; fn <= BENCH_MEMMEM; fn++) {
+		if (in->binary && fn != BENCH_MEMMEM)
+			pr_cont(" %11s", "-");
+		else
+			pr_cont(" %9llu.%llu", tenths[fn] / 10, tenths[fn] % 10);
+	}
+	pr_cont("%s\n", bad ? " !" : "");
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t needle_lens[] = { 16, 256, 4096 };
+	struct bench_input in[] = {
+		{ "cmdline",	bench_cmdline, 0, "androidboot.serialno=" },
+		{ "cmdline",	bench_cmdline, 0, "efidroid.multiboot=" },
+		{ "cmdline",	bench_cmdline, 0, "androidboot.slot_suffix=" },
+		{ "props",	bench_props, 0, "ro.hardware=" },
+		{ "props",	bench_props, 0, "\npersist.sys.usb.config=" },
+		{ "props",	bench_props, 0, "ro.boot.serialno=" },
+		{ "cpio",	bench_cpio, 0, "070701", true },
+		{ "cpio",	bench_cpio, 0, "sbin/ueventd", true },
+		{ "cpio",	bench_cpio, 0, "TRAILER!!!", true },
+		{ "periodic",	bench_periodic, 0, bench_needles[0] },
+		{ "periodic",	bench_periodic, 0, bench_needles[1] },
+		{ "periodic",	bench_periodic, 0, bench_needles[2] },
+	};
+	unsigned long ms = BENCH_MS;
+	unsigned int i;
+
+	if (argc > 2 || (argc == 2 && (kstrtoul(argv[1], 0, &ms) || !ms))) {
+		pr_err("usage: %s [ms per figure]\n", argv[0]);
+		return 2;
+	}
+	bench_target_ns = ms * 1000000ULL;
+
+	memset(bench_periodic, 'a', BENCH_PERIODIC);
+	for (i = 0; i < sizeof(needle_lens) / sizeof(needle_lens[0]); i++) {
+		memset(bench_needles[i], 'a', needle_lens[i] - 1);
+		bench_needles[i][needle_lens[i] - 1] = 'b';
+	}
+	bench_make_cpio();
+
+	for (i = 0; i < sizeof(in) / sizeof(in[0]); i++)
+		in[i].len = in[i].binary ? bench_cpio_len : strlen(in[i].hay);
+
+	pr_info("%s: ns per call\n", argv[0]);
+	pr_info("input                 hay needle     at      strstr     strnstr      memmem\n");
+
+	for (i = 0; i < sizeof(in) / sizeof(in[0]); i++)
+		bench_one(&in[i]);
+
+	return 0;
+}